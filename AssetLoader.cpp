@@ -0,0 +1,91 @@
+#include "AssetLoader.h"
+#include <algorithm>
+#include <chrono>
+
+AssetLoader::AssetLoader(unsigned threadCount)
+    : stopping(false), totalJobs(0), finishedJobs(0) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned i = 0; i < threadCount; ++i) {
+    workers.emplace_back(&AssetLoader::work, this);
+  }
+}
+
+AssetLoader::~AssetLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobReady.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void AssetLoader::add(Job job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(std::move(job));
+    ++totalJobs;
+  }
+  jobReady.notify_one();
+}
+
+void AssetLoader::work() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+      if (jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+
+    Finish finish = job();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.push_back(std::move(finish));
+    }
+    finishReady.notify_one();
+  }
+}
+
+bool AssetLoader::run(const Progress &progress) {
+  bool ok = true;
+  for (;;) {
+    std::deque<Finish> ready;
+    int total;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (finishedJobs == totalJobs) {
+        break;
+      }
+      // Wake at least once a frame so the caller's progress callback can
+      // keep the window responsive
+      finishReady.wait_for(lock, std::chrono::milliseconds(16),
+                           [this]() { return !finished.empty(); });
+      ready.swap(finished);
+      total = totalJobs;
+    }
+
+    for (Finish &finish : ready) {
+      ok = (!finish || finish()) && ok;
+    }
+
+    int finishedSoFar;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finishedJobs += static_cast<int>(ready.size());
+      finishedSoFar = finishedJobs;
+    }
+    if (progress) {
+      progress(finishedSoFar, total);
+    }
+  }
+  return ok;
+}
@@ -0,0 +1,45 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decodes assets on a pool of worker threads. Each job runs on a worker and
+// hands back a finishing step (texture upload, bookkeeping) that run()
+// executes on the calling thread, which must be the one that owns the
+// renderer.
+class AssetLoader {
+public:
+  // Runs on the loading thread; returns false if the asset failed
+  typedef std::function<bool()> Finish;
+  typedef std::function<Finish()> Job;
+  typedef std::function<void(int finished, int total)> Progress;
+
+  // threadCount 0 uses one worker per hardware thread
+  explicit AssetLoader(unsigned threadCount = 0);
+  ~AssetLoader();
+
+  void add(Job job);
+  // Finishes jobs as they complete until all added jobs are done, calling
+  // progress after each batch. Returns false if any asset failed.
+  bool run(const Progress &progress = Progress());
+
+private:
+  void work();
+
+  std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable finishReady;
+  std::deque<Job> jobs;
+  std::deque<Finish> finished;
+  std::vector<std::thread> workers;
+  bool stopping;
+  int totalJobs;
+  int finishedJobs;
+};
+
+#endif
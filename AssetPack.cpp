@@ -0,0 +1,146 @@
+#include "AssetPack.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetPack::AssetPack()
+    : base(nullptr), length(0),
+#ifdef _WIN32
+      file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#else
+      file(-1)
+#endif
+{
+}
+
+AssetPack::~AssetPack() { close(); }
+
+// Whether an entry's data is as large as its own fields say. Textures are
+// wrapped and sounds played straight from the mapping, so a stale or
+// truncated pack would otherwise be read past its end.
+static bool isValidEntry(const AssetPackEntry &entry) {
+  if (entry.type == ASSET_TEXTURE) {
+    return entry.pitch >= static_cast<Uint64>(entry.width) * 4 &&
+           static_cast<Uint64>(entry.pitch) * entry.height <= entry.size;
+  }
+  if (entry.type == ASSET_SOUND) {
+    Uint64 frameBytes =
+        static_cast<Uint64>(SDL_AUDIO_BITSIZE(entry.format) / 8) *
+        entry.channels;
+    return frameBytes > 0 && entry.size % frameBytes == 0;
+  }
+  return true;
+}
+
+bool AssetPack::open(const std::string &path) {
+  close();
+
+#ifdef _WIN32
+  file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    close();
+    return false;
+  }
+  length = static_cast<size_t>(size.QuadPart);
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping) {
+    base = static_cast<const Uint8 *>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+#else
+  file = ::open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(file, &info) != 0 || info.st_size == 0) {
+    close();
+    return false;
+  }
+  length = static_cast<size_t>(info.st_size);
+  void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+  if (mapped != MAP_FAILED) {
+    base = static_cast<const Uint8 *>(mapped);
+  }
+#endif
+  if (!base) {
+    std::cerr << "Unable to map asset pack " << path << std::endl;
+    close();
+    return false;
+  }
+
+  // Validate the header and index before trusting any offsets
+  const AssetPackHeader *header =
+      reinterpret_cast<const AssetPackHeader *>(base);
+  if (length < sizeof(AssetPackHeader) ||
+      std::memcmp(header->magic, ASSET_PACK_MAGIC, 4) != 0 ||
+      header->version != ASSET_PACK_VERSION ||
+      header->indexOffset > length ||
+      header->indexOffset % alignof(AssetPackEntry) != 0 ||
+      (length - header->indexOffset) / sizeof(AssetPackEntry) <
+          header->entryCount) {
+    std::cerr << "Invalid asset pack " << path << std::endl;
+    close();
+    return false;
+  }
+
+  const AssetPackEntry *index =
+      reinterpret_cast<const AssetPackEntry *>(base + header->indexOffset);
+  for (Uint32 i = 0; i < header->entryCount; ++i) {
+    const AssetPackEntry &entry = index[i];
+    if (entry.offset > length || entry.size > length - entry.offset ||
+        std::memchr(entry.name, '\0', sizeof(entry.name)) == nullptr ||
+        !isValidEntry(entry)) {
+      std::cerr << "Invalid asset pack entry in " << path << std::endl;
+      close();
+      return false;
+    }
+    entries[entry.name] = &entry;
+  }
+  return true;
+}
+
+void AssetPack::close() {
+  entries.clear();
+#ifdef _WIN32
+  if (base) {
+    UnmapViewOfFile(base);
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (base) {
+    munmap(const_cast<Uint8 *>(base), length);
+  }
+  if (file >= 0) {
+    ::close(file);
+    file = -1;
+  }
+#endif
+  base = nullptr;
+  length = 0;
+}
+
+const AssetPackEntry *AssetPack::find(const std::string &name) const {
+  auto found = entries.find(name);
+  return found != entries.end() ? found->second : nullptr;
+}
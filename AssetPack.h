@@ -0,0 +1,77 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <SDL.h>
+#include <string>
+#include <unordered_map>
+
+// Single-file asset pack written by tools/packer.cpp. Everything is stored
+// ready to use, so loading is a memory map and a lookup:
+//   textures - RGBA32 pixels
+//   sounds   - PCM already in the mixer's output format
+//   fonts    - the TTF file as-is
+//   raw      - any other file as-is
+// Layout: header, entry data (16-byte aligned), then the entry index
+// (aligned for AssetPackEntry).
+// Integers are little-endian.
+const char ASSET_PACK_MAGIC[4] = {'G', 'P', 'A', 'K'};
+const Uint32 ASSET_PACK_VERSION = 1;
+const char DEFAULT_ASSET_PACK[] = "res/assets.pak";
+
+enum AssetType {
+  ASSET_TEXTURE = 1,
+  ASSET_SOUND = 2,
+  ASSET_FONT = 3,
+  ASSET_RAW = 4
+};
+
+struct AssetPackHeader {
+  char magic[4];
+  Uint32 version;
+  Uint32 entryCount;
+  Uint32 reserved;
+  Uint64 indexOffset;
+};
+
+struct AssetPackEntry {
+  char name[64]; // Source path, e.g. "res/ball.png"
+  Uint32 type;
+  Uint32 width, height, pitch; // Textures
+  Uint32 frequency;            // Sounds, with format and channels
+  Uint16 format;
+  Uint16 channels;
+  Uint64 offset;
+  Uint64 size;
+};
+
+class AssetPack {
+public:
+  AssetPack();
+  ~AssetPack();
+  AssetPack(const AssetPack &) = delete;
+  AssetPack &operator=(const AssetPack &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const { return base != nullptr; }
+
+  // Entry for a source path, or nullptr if the pack doesn't hold it
+  const AssetPackEntry *find(const std::string &name) const;
+  // Mapped bytes of an entry; valid until close()
+  const Uint8 *data(const AssetPackEntry &entry) const {
+    return base + entry.offset;
+  }
+
+private:
+  const Uint8 *base;
+  size_t length;
+#ifdef _WIN32
+  void *file;
+  void *mapping;
+#else
+  int file;
+#endif
+  std::unordered_map<std::string, const AssetPackEntry *> entries;
+};
+
+#endif
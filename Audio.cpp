@@ -0,0 +1,112 @@
+#include "Audio.h"
+#include <algorithm>
+#include <iostream>
+
+Audio::Voice Audio::voices[Audio::MAX_VOICES];
+Audio::Play Audio::pending[Audio::MAX_PENDING_PLAYS];
+std::atomic<unsigned> Audio::pendingHead(0);
+std::atomic<unsigned> Audio::pendingTail(0);
+
+bool Audio::open(int bufferSamples) {
+  // Only the rate may differ from what was asked for; SDL converts anything
+  // else, so every decoded sound is 16-bit stereo, which mix() relies on
+  if (Mix_OpenAudioDevice(DEFAULT_AUDIO_FREQUENCY, AUDIO_S16SYS,
+                          AUDIO_CHANNELS, bufferSamples, nullptr,
+                          SDL_AUDIO_ALLOW_FREQUENCY_CHANGE) == -1) {
+    std::cerr << "SDL_mixer open audio error: " << Mix_GetError() << std::endl;
+    return false;
+  }
+
+  for (Voice &voice : voices) {
+    voice.samples = nullptr;
+  }
+  pendingHead = 0;
+  pendingTail = 0;
+  // The music hook runs first in every device callback, on a buffer the
+  // mixer has already silenced; nothing else is mixed on top
+  Mix_HookMusic(mix, nullptr);
+  return true;
+}
+
+void Audio::close() {
+  // Returns only once the callback can no longer be running
+  Mix_HookMusic(nullptr, nullptr);
+  Mix_CloseAudio();
+  for (Voice &voice : voices) {
+    voice.samples = nullptr;
+  }
+}
+
+void Audio::play(const Mix_Chunk *sound, float volume, float pitch) {
+  if (!sound || !sound->abuf) {
+    return;
+  }
+  unsigned tail = pendingTail.load(std::memory_order_relaxed);
+  if (tail - pendingHead.load(std::memory_order_acquire) ==
+      MAX_PENDING_PLAYS) {
+    // The audio thread is stalled; a late effect is worse than none
+    return;
+  }
+  pending[tail % MAX_PENDING_PLAYS] = {sound, volume, pitch};
+  pendingTail.store(tail + 1, std::memory_order_release);
+}
+
+void Audio::startPending() {
+  unsigned head = pendingHead.load(std::memory_order_relaxed);
+  unsigned tail = pendingTail.load(std::memory_order_acquire);
+  for (; head != tail; ++head) {
+    const Play &play = pending[head % MAX_PENDING_PLAYS];
+
+    Voice *voice = &voices[0];
+    for (Voice &candidate : voices) {
+      if (!candidate.samples) {
+        voice = &candidate;
+        break;
+      }
+      if (candidate.position > voice->position) {
+        voice = &candidate;
+      }
+    }
+
+    voice->samples = reinterpret_cast<const Sint16 *>(play.sound->abuf);
+    voice->frames = play.sound->alen / (sizeof(Sint16) * AUDIO_CHANNELS);
+    voice->position = 0;
+    voice->step = std::max(1, static_cast<int>(play.pitch * 65536.0f));
+    voice->gain = std::min(
+        256, std::max(0, static_cast<int>(play.volume * 256.0f + 0.5f)));
+  }
+  pendingHead.store(head, std::memory_order_release);
+}
+
+void SDLCALL Audio::mix(void *, Uint8 *stream, int length) {
+  startPending();
+
+  Sint16 *out = reinterpret_cast<Sint16 *>(stream);
+  int frames = length / static_cast<int>(sizeof(Sint16) * AUDIO_CHANNELS);
+  for (Voice &voice : voices) {
+    if (!voice.samples) {
+      continue;
+    }
+    for (int frame = 0; frame < frames; ++frame) {
+      Uint32 index = static_cast<Uint32>(voice.position >> 16);
+      if (index + 1 >= voice.frames) {
+        voice.samples = nullptr;
+        break;
+      }
+      // Linear interpolation between neighbouring frames repitches the
+      // sound without resampling it up front
+      Sint64 fraction = voice.position & 0xFFFF;
+      const Sint16 *from = voice.samples + index * AUDIO_CHANNELS;
+      const Sint16 *to = from + AUDIO_CHANNELS;
+      for (int channel = 0; channel < AUDIO_CHANNELS; ++channel) {
+        Sint64 sample =
+            from[channel] + (((to[channel] - from[channel]) * fraction) >> 16);
+        Sint64 mixed = out[frame * AUDIO_CHANNELS + channel] +
+                       ((sample * voice.gain) >> 8);
+        mixed = std::min<Sint64>(32767, std::max<Sint64>(-32768, mixed));
+        out[frame * AUDIO_CHANNELS + channel] = static_cast<Sint16>(mixed);
+      }
+      voice.position += voice.step;
+    }
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <atomic>
+
+// Rate the device is opened at unless it prefers another, in which case its
+// own rate is used. tools/packer decodes sounds for this rate by default.
+const int DEFAULT_AUDIO_FREQUENCY = 48000;
+const int AUDIO_CHANNELS = 2;
+// Sample frames per device buffer: about 5 ms at 48 kHz, against the 186 ms
+// the mixer's usual 4096 frames at 22050 Hz took
+const int DEFAULT_AUDIO_BUFFER = 256;
+
+// Sound effects with low latency. SDL_mixer opens the device and decodes
+// sounds into the device's format when they're loaded; playback goes through
+// a fixed pool of voices mixed straight into the device buffer, each with
+// its own volume and pitch. play() is lock-free and never allocates.
+class Audio {
+public:
+  // bufferSamples is in sample frames and should be a power of two
+  static bool open(int bufferSamples = DEFAULT_AUDIO_BUFFER);
+  // Stops every voice; sounds may be freed once this returns
+  static void close();
+  // Starts sound on a free voice, or on the one that has played longest if
+  // all are busy. volume scales from silence (0) to as recorded (1); pitch is
+  // the playback rate, 1 being as recorded. Only call from one thread.
+  static void play(const Mix_Chunk *sound, float volume = 1.0f,
+                   float pitch = 1.0f);
+
+private:
+  static const int MAX_VOICES = 16;
+  // Plays queued for the audio thread; a power of two
+  static const unsigned MAX_PENDING_PLAYS = 32;
+
+  struct Voice {
+    const Sint16 *samples; // Interleaved, AUDIO_CHANNELS per frame
+    Uint32 frames;
+    Uint64 position; // Frames, 16.16 fixed point
+    Uint32 step;     // Frames per output frame, 16.16 fixed point
+    int gain;        // 0-256
+  };
+  struct Play {
+    const Mix_Chunk *sound;
+    float volume, pitch;
+  };
+
+  static void SDLCALL mix(void *userdata, Uint8 *stream, int length);
+  static void startPending();
+
+  static Voice voices[MAX_VOICES];
+  static Play pending[MAX_PENDING_PLAYS];
+  // pendingTail is advanced by play(), pendingHead by the audio thread
+  static std::atomic<unsigned> pendingHead, pendingTail;
+};
+
+#endif
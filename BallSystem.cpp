@@ -0,0 +1,270 @@
+#include "BallSystem.h"
+#include <algorithm>
+#include <cmath>
+
+void BallSystem::clear() {
+  x.clear();
+  y.clear();
+  velX.clear();
+  velY.clear();
+  bounceCounts.clear();
+  count = 0;
+}
+
+int BallSystem::add(const SDL_Rect &rect) {
+  if (count % SIMD_LANES == 0) {
+    size_t padded = count + SIMD_LANES;
+    x.resize(padded, 0);
+    y.resize(padded, 0);
+    velX.resize(padded, 0);
+    velY.resize(padded, 0);
+    bounceCounts.resize(padded, 0);
+  }
+  x[count] = static_cast<float>(rect.x);
+  y[count] = static_cast<float>(rect.y);
+  return static_cast<int>(count++);
+}
+
+Ball BallSystem::ball(int index) const {
+  return {x[index], y[index], velX[index], velY[index], BALL_SIZE, BALL_SIZE};
+}
+
+void BallSystem::setBall(int index, const Ball &ball) {
+  x[index] = ball.x;
+  y[index] = ball.y;
+  velX[index] = ball.velX;
+  velY[index] = ball.velY;
+}
+
+void BallSystem::launch(int index, int targetX, int targetY,
+                        Uint32 pressDuration) {
+  Ball launched = ball(index);
+  launchBall(launched, targetX, targetY, pressDuration);
+  setBall(index, launched);
+  bounceCounts[index] = 0;
+}
+
+bool BallSystem::moving() const {
+  for (size_t i = 0; i < count; ++i) {
+    if (velX[i] != 0 || velY[i] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BallSystem::step(const SDL_Rect objects[], const SpatialGrid &grid,
+                      const SDL_Rect &holeRect, const SDL_Rect &bounds,
+                      float dt, BallEvent events[]) {
+  // Friction and travel are the same for every ball; see updateBallPosition
+  const float ticks = dt * REFERENCE_TICK_RATE;
+  const float friction = std::pow(FRICTION, ticks);
+  const float travel = (1.0f / friction - 1.0f) / -std::log(FRICTION);
+
+  BallEvent laneEvents[SIMD_LANES];
+  for (size_t first = 0; first < count; first += SIMD_LANES) {
+    stepLanes(first, objects, grid, holeRect, bounds, friction, travel,
+              laneEvents);
+    std::copy(laneEvents,
+              laneEvents + std::min<size_t>(SIMD_LANES, count - first),
+              events + first);
+  }
+}
+
+void BallSystem::stepLanes(size_t first, const SDL_Rect objects[],
+                           const SpatialGrid &grid, const SDL_Rect &holeRect,
+                           const SDL_Rect &bounds, float friction,
+                           float travel, BallEvent events[]) {
+  const Lanes zero = lanesBroadcast(0.0f);
+  const Lanes one = lanesBroadcast(1.0f);
+  const Lanes minusOne = lanesBroadcast(-1.0f);
+  const Lanes infinity = lanesBroadcast(INFINITY);
+  const Lanes minusInfinity = lanesBroadcast(-INFINITY);
+  const Lanes size = lanesBroadcast(static_cast<float>(BALL_SIZE));
+  const Lanes allSet = equal(zero, zero);
+
+  for (int i = 0; i < SIMD_LANES; ++i) {
+    events[i] = BALL_NONE;
+  }
+
+  Lanes ballX = lanesLoad(&x[first]);
+  Lanes ballY = lanesLoad(&y[first]);
+  Lanes vx = lanesLoad(&velX[first]) * lanesBroadcast(friction);
+  Lanes vy = lanesLoad(&velY[first]) * lanesBroadcast(friction);
+  const Lanes stopSpeed = lanesBroadcast(0.1f);
+  vx = select(lessThan(abs(vx), stopSpeed), zero, vx);
+  vy = select(lessThan(abs(vy), stopSpeed), zero, vy);
+
+  // Entry and exit times of every lane's box against one rect along one
+  // axis, as sweepBall computes them; miss is set where a lane not moving on
+  // this axis doesn't overlap the rect on it either
+  auto axisTimes = [&](Lanes position, Lanes move, float rectPosition,
+                       float rectSize, Lanes &entry, Lanes &exit,
+                       Lanes &miss) {
+    Lanes low = lanesBroadcast(rectPosition);
+    Lanes high = lanesBroadcast(rectPosition + rectSize);
+    Lanes positive = greaterThan(move, zero);
+    Lanes still = equal(move, zero);
+    Lanes toLow = low - (position + size);
+    Lanes toHigh = high - position;
+    entry = select(still, minusInfinity,
+                   select(positive, toLow, toHigh) / move);
+    exit = select(still, infinity, select(positive, toHigh, toLow) / move);
+    miss = still & (lessEqual(position + size, low) |
+                    greaterEqual(position, high));
+  };
+
+  // Swept test of every lane against rect; entry is the time of impact
+  auto sweep = [&](Lanes moveX, Lanes moveY, const SDL_Rect &rect,
+                   Lanes &entry, Lanes &entryX, Lanes &entryY) {
+    Lanes exitX, exitY, missX, missY;
+    axisTimes(ballX, moveX, static_cast<float>(rect.x),
+              static_cast<float>(rect.w), entryX, exitX, missX);
+    axisTimes(ballY, moveY, static_cast<float>(rect.y),
+              static_cast<float>(rect.h), entryY, exitY, missY);
+    entry = max(entryX, entryY);
+    Lanes exit = min(exitX, exitY);
+    return andNot(missX | missY, lessThan(entry, exit) &
+                                     greaterThan(exit, zero) &
+                                     lessEqual(entry, one));
+  };
+
+  Lanes remaining = one;
+  Lanes done = zero;
+  for (int contact = 0; contact < MAX_CONTACTS_PER_STEP; ++contact) {
+    Lanes moveX = vx * lanesBroadcast(travel) * remaining;
+    Lanes moveY = vy * lanesBroadcast(travel) * remaining;
+    Lanes active = andNot(done | (equal(moveX, zero) & equal(moveY, zero)),
+                          allSet);
+    int activeBits = laneBits(active);
+    if (!activeBits) {
+      break;
+    }
+
+    // Obstacles near the swept box of any active lane
+    float lanesX[SIMD_LANES], lanesY[SIMD_LANES], movesX[SIMD_LANES],
+        movesY[SIMD_LANES];
+    lanesStore(lanesX, ballX);
+    lanesStore(lanesY, ballY);
+    lanesStore(movesX, moveX);
+    lanesStore(movesY, moveY);
+    float left = INFINITY, top = INFINITY, right = -INFINITY,
+          bottom = -INFINITY;
+    for (int i = 0; i < SIMD_LANES; ++i) {
+      if (activeBits & (1 << i)) {
+        left = std::min(left, std::min(lanesX[i], lanesX[i] + movesX[i]));
+        top = std::min(top, std::min(lanesY[i], lanesY[i] + movesY[i]));
+        right = std::max(right, std::max(lanesX[i], lanesX[i] + movesX[i]));
+        bottom = std::max(bottom, std::max(lanesY[i], lanesY[i] + movesY[i]));
+      }
+    }
+    SDL_Rect sweptBounds = {
+        static_cast<int>(std::floor(left)), static_cast<int>(std::floor(top)),
+        static_cast<int>(std::ceil(right - left)) + BALL_SIZE + 1,
+        static_cast<int>(std::ceil(bottom - top)) + BALL_SIZE + 1};
+    candidates.clear();
+    grid.query(sweptBounds, [&](int i) { candidates.push_back(i); });
+
+    // Earliest face each lane hits; objects already overlapped are ignored
+    // so the ball can move out, as in updateBallPosition
+    Lanes hitTime = one, normalX = zero, normalY = zero;
+    Lanes hitObject = minusOne;
+    for (int object : candidates) {
+      Lanes entry, entryX, entryY;
+      Lanes hit = sweep(moveX, moveY, objects[object], entry, entryX, entryY);
+      hit = hit & active & greaterEqual(entry, zero) & lessThan(entry, hitTime);
+      if (!laneBits(hit)) {
+        continue;
+      }
+      Lanes xFace = greaterEqual(entryX, entryY);
+      Lanes faceX = select(greaterThan(moveX, zero), minusOne, one);
+      Lanes faceY = select(greaterThan(moveY, zero), minusOne, one);
+      hitTime = select(hit, entry, hitTime);
+      normalX = select(hit, select(xFace, faceX, zero), normalX);
+      normalY = select(hit, select(xFace, zero, faceY), normalY);
+      hitObject =
+          select(hit, lanesBroadcast(static_cast<float>(object)), hitObject);
+    }
+
+    // The hole takes the ball unless an object is struck first
+    Lanes holeEntry, holeEntryX, holeEntryY;
+    Lanes holed =
+        sweep(moveX, moveY, holeRect, holeEntry, holeEntryX, holeEntryY);
+    holed = holed & active & lessEqual(max(holeEntry, zero), hitTime);
+    ballX = select(holed,
+                   lanesBroadcast(static_cast<float>(holeRect.x +
+                                                     holeRect.w / 4)),
+                   ballX + moveX * hitTime);
+    ballY = select(holed,
+                   lanesBroadcast(static_cast<float>(holeRect.y +
+                                                     holeRect.h / 4)),
+                   ballY + moveY * hitTime);
+    ballX = select(active, ballX, lanesLoad(lanesX));
+    ballY = select(active, ballY, lanesLoad(lanesY));
+    vx = select(holed, zero, vx);
+    vy = select(holed, zero, vy);
+
+    Lanes bounced = andNot(holed, active & greaterEqual(hitObject, zero));
+    done = done | andNot(bounced, active);
+    int holedBits = laneBits(holed);
+    int bouncedBits = laneBits(bounced);
+    for (int i = 0; i < SIMD_LANES; ++i) {
+      if (holedBits & (1 << i)) {
+        events[i] = BALL_ENTERED_HOLE;
+      }
+    }
+    if (!bouncedBits) {
+      continue;
+    }
+
+    // Reflection snaps each ball to the face it hit, which needs the
+    // object's rect, so it runs per lane
+    float ballsX[SIMD_LANES], ballsY[SIMD_LANES], vxs[SIMD_LANES],
+        vys[SIMD_LANES], normalsX[SIMD_LANES], normalsY[SIMD_LANES],
+        objectIndices[SIMD_LANES];
+    lanesStore(ballsX, ballX);
+    lanesStore(ballsY, ballY);
+    lanesStore(vxs, vx);
+    lanesStore(vys, vy);
+    lanesStore(normalsX, normalX);
+    lanesStore(normalsY, normalY);
+    lanesStore(objectIndices, hitObject);
+    for (int i = 0; i < SIMD_LANES; ++i) {
+      if (!(bouncedBits & (1 << i))) {
+        continue;
+      }
+      Ball ball = {ballsX[i], ballsY[i], vxs[i], vys[i], BALL_SIZE, BALL_SIZE};
+      reflectBallOffObject(ball, objects[static_cast<int>(objectIndices[i])],
+                           normalsX[i], normalsY[i]);
+      ballsX[i] = ball.x;
+      ballsY[i] = ball.y;
+      vxs[i] = ball.velX;
+      vys[i] = ball.velY;
+      ++bounceCounts[first + i];
+      events[i] = BALL_BOUNCED;
+    }
+    ballX = lanesLoad(ballsX);
+    ballY = lanesLoad(ballsY);
+    vx = lanesLoad(vxs);
+    vy = lanesLoad(vys);
+    remaining = select(bounced, remaining * (one - hitTime), remaining);
+  }
+
+  lanesStore(&x[first], ballX);
+  lanesStore(&y[first], ballY);
+  lanesStore(&velX[first], vx);
+  lanesStore(&velY[first], vy);
+
+  for (int i = 0; i < SIMD_LANES; ++i) {
+    size_t index = first + i;
+    if (events[i] != BALL_ENTERED_HOLE &&
+        (x[index] < bounds.x || x[index] > bounds.x + bounds.w - BALL_SIZE ||
+         y[index] < bounds.y ||
+         y[index] > bounds.y + bounds.h - BALL_SIZE)) {
+      x[index] = static_cast<float>(bounds.x + 3 * bounds.w / 4);
+      y[index] = static_cast<float>(bounds.y + 3 * bounds.h / 4);
+      velX[index] = velY[index] = 0;
+      events[i] = BALL_OUT_OF_BOUNDS;
+    }
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef BALLSYSTEM_H
+#define BALLSYSTEM_H
+
+#include "Physics.h"
+#include "Simd.h"
+#include "SpatialGrid.h"
+#include <SDL.h>
+#include <vector>
+
+// Many balls stepped together, for ghost balls, local multiplayer and bulk
+// shot evaluation. Positions and velocities live in separate float arrays
+// (structure of arrays) so SIMD_LANES balls go through friction, motion and
+// each obstacle test at once. Stepping matches updateBallPosition for a
+// released ball of BALL_SIZE, except that a ball entering the hole stops
+// there instead of playing the drop animation.
+//
+// Each group of lanes tests the obstacles near all of its moving balls, so
+// balls that travel close together, like shots from one spot, step fastest.
+class BallSystem {
+public:
+  void clear();
+  // Adds a resting ball and returns its index
+  int add(const SDL_Rect &rect);
+  size_t size() const { return count; }
+
+  Ball ball(int index) const;
+  void setBall(int index, const Ball &ball);
+  void launch(int index, int targetX, int targetY, Uint32 pressDuration);
+  int bounces(int index) const { return bounceCounts[index]; }
+  // True while any ball has velocity left
+  bool moving() const;
+
+  // Advances every ball by dt seconds and stores what happened to ball i in
+  // events[i]. grid must index objects; bounds is the playfield.
+  void step(const SDL_Rect objects[], const SpatialGrid &grid,
+            const SDL_Rect &holeRect, const SDL_Rect &bounds, float dt,
+            BallEvent events[]);
+
+private:
+  void stepLanes(size_t first, const SDL_Rect objects[],
+                 const SpatialGrid &grid, const SDL_Rect &holeRect,
+                 const SDL_Rect &bounds, float friction, float travel,
+                 BallEvent events[]);
+
+  // Padded to a whole number of lane groups with resting balls
+  std::vector<float> x, y, velX, velY;
+  std::vector<int> bounceCounts;
+  std::vector<int> candidates; // Obstacles near the current lane group
+  size_t count = 0;
+};
+
+#endif
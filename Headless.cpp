@@ -0,0 +1,481 @@
+#include "Headless.h"
+#include "BallSystem.h"
+#include "LevelGenerator.h"
+#include "Replay.h"
+#include "Rewind.h"
+#include "Solver.h"
+#include "Physics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool loadShots(const std::string &path, std::vector<Shot> &shots) {
+  std::ifstream file;
+  if (path != "-") {
+    file.open(path);
+    if (!file) {
+      std::cerr << "Unable to open shots " << path << std::endl;
+      return false;
+    }
+  }
+  std::istream &input = path == "-" ? std::cin : file;
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(input, line)) {
+    ++lineNumber;
+    std::istringstream in(line);
+    Shot shot;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    if (!(in >> shot.aimX >> shot.aimY >> shot.pressDuration)) {
+      std::cerr << path << ":" << lineNumber << ": bad shot: " << line
+                << std::endl;
+      return false;
+    }
+    shots.push_back(shot);
+  }
+  return true;
+}
+
+ShotOutcome simulateShot(const Level &level, const SpatialGrid &grid,
+                         Ball &ball, int targetX, int targetY,
+                         Uint32 pressDuration, int tickRate) {
+  ShotOutcome outcome = {false, false, 0, 0, ball.rect()};
+  const float dt = 1.0f / tickRate;
+
+  bool ballInHole = false;
+  float animationProgress = 0.0f;
+  launchBall(ball, targetX, targetY, pressDuration);
+
+  while (outcome.ticks < MAX_SHOT_TICKS) {
+    ++outcome.ticks;
+    BallEvent event = updateBallPosition(
+        ball, false, level.objects.data(), grid, level.holeRect,
+        level.bounds, ballInHole, animationProgress, outcome.bounces, dt);
+
+    if (event == BALL_ENTERED_HOLE) {
+      // The drop animation is presentation only
+      outcome.holed = true;
+      break;
+    }
+    if (event == BALL_OUT_OF_BOUNDS) {
+      outcome.outOfBounds = true;
+      break;
+    }
+    if (ball.velX == 0 && ball.velY == 0) {
+      break;
+    }
+  }
+
+  outcome.finalBallRect = ball.rect();
+  return outcome;
+}
+
+ShotOutcome simulateShot(const Level &level, const SpatialGrid &grid,
+                         SDL_Rect &ballRect, const Shot &shot, int tickRate) {
+  Ball ball;
+  placeBall(ball, ballRect);
+  ShotOutcome outcome = simulateShot(
+      level, grid, ball, ballRect.x + ballRect.w / 2 + shot.aimX,
+      ballRect.y + ballRect.h / 2 + shot.aimY, shot.pressDuration, tickRate);
+  ballRect = outcome.finalBallRect;
+  return outcome;
+}
+
+static void printUsage() {
+  std::cerr << "usage: game --headless [--level FILE] [--shots FILE|-]"
+               " [--repeat N] [--tick-rate HZ] [--quiet]\n"
+               "       game --headless --replay FILE [--repeat N] [--quiet]"
+            << std::endl;
+}
+
+// Plays a recorded session as fast as possible. Idle ticks between records
+// change nothing once the ball rests, so each stroke is simulated straight
+// through. Prints a digest of where every stroke ended for comparing runs.
+// Strokes run straight to rest leave no tick to rewind to, so playback
+// stops at the first rewind.
+static int runReplay(const Replay &replay, long repeat, bool quiet) {
+  const size_t playable = static_cast<size_t>(
+      std::find_if(replay.records.begin(), replay.records.end(),
+                   [](const ReplayRecord &record) {
+                     return record.type == REPLAY_REWIND;
+                   }) -
+      replay.records.begin());
+  if (playable < replay.records.size()) {
+    std::cerr << "Stopping at the rewind at tick "
+              << replay.records[playable].tick
+              << "; rewinds can only be played back in the game window"
+              << std::endl;
+  }
+
+  Level level = defaultLevel();
+  SpatialGrid grid;
+  grid.build(level.objects.data(), level.objects.size());
+  Ball ball;
+  placeBall(ball, level.ballRect);
+  std::vector<Ball> strokeStarts; // Where each stroke of the level began
+
+  long totalShots = 0, totalHoled = 0;
+  long long totalTicks = 0;
+  uint64_t digest = 14695981039346656037ull; // FNV-1a
+  auto mix = [&digest](uint64_t value) {
+    for (int i = 0; i < 8; ++i, value >>= 8) {
+      digest = (digest ^ (value & 0xFF)) * 1099511628211ull;
+    }
+  };
+  auto start = std::chrono::steady_clock::now();
+
+  for (long pass = 0; pass < repeat; ++pass) {
+    for (size_t i = 0; i < playable; ++i) {
+      const ReplayRecord &record = replay.records[i];
+      if (record.type == REPLAY_LEVEL) {
+        if (!levelFromSeed(record.seed, level, replay.courseSize)) {
+          std::cerr << "No playable layout for seed " << record.seed
+                    << std::endl;
+          return 1;
+        }
+        grid.build(level.objects.data(), level.objects.size());
+        placeBall(ball, level.ballRect);
+        strokeStarts.clear();
+        continue;
+      }
+      if (record.type == REPLAY_UNDO) {
+        if (!strokeStarts.empty()) {
+          ball = strokeStarts.back();
+          strokeStarts.pop_back();
+        }
+        continue;
+      }
+
+      // Undo keeps as many strokes as the game's rewind history does
+      if (strokeStarts.size() == REWIND_MAX_STROKES) {
+        strokeStarts.erase(strokeStarts.begin());
+      }
+      strokeStarts.push_back(ball);
+
+      ShotOutcome outcome =
+          simulateShot(level, grid, ball, record.targetX, record.targetY,
+                       record.pressDuration, replay.tickRate);
+      ++totalShots;
+      totalHoled += outcome.holed;
+      totalTicks += outcome.ticks;
+      if (pass > 0) {
+        continue;
+      }
+
+      // Every pass plays the same, so the first one stands for the run
+      uint32_t x, y;
+      std::memcpy(&x, &ball.x, sizeof(x));
+      std::memcpy(&y, &ball.y, sizeof(y));
+      mix(static_cast<uint64_t>(x) << 32 | y);
+      mix(static_cast<uint64_t>(outcome.bounces) << 2 |
+          outcome.outOfBounds << 1 | outcome.holed);
+
+      if (!quiet) {
+        std::cout << "tick " << record.tick << " shot " << totalShots << ": "
+                  << (outcome.holed         ? "holed"
+                      : outcome.outOfBounds ? "out"
+                                            : "rest")
+                  << " bounces=" << outcome.bounces
+                  << " ball=(" << ball.x << "," << ball.y << ")"
+                  << std::endl;
+      }
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double lastTick =
+      playable == 0 ? 0
+                    : static_cast<double>(replay.records[playable - 1].tick);
+  double sessionSeconds = repeat * lastTick / replay.tickRate;
+  std::cout << "shots=" << totalShots << " holed=" << totalHoled
+            << " ticks=" << totalTicks << " elapsed=" << elapsed.count()
+            << "s speed=" << sessionSeconds / std::max(elapsed.count(), 1e-9)
+            << "x digest=" << std::hex << digest << std::dec << std::endl;
+  return 0;
+}
+
+int runHeadless(int argc, char *args[]) {
+  Level level = defaultLevel();
+  std::string shotsPath = "-";
+  std::string replayPath;
+  long repeat = 1;
+  int tickRate = DEFAULT_TICK_RATE;
+  bool quiet = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(args[i], "--headless") == 0) {
+      continue;
+    } else if (std::strcmp(args[i], "--level") == 0 && i + 1 < argc) {
+      if (!loadLevel(args[++i], level)) {
+        return 1;
+      }
+    } else if (std::strcmp(args[i], "--shots") == 0 && i + 1 < argc) {
+      shotsPath = args[++i];
+    } else if (std::strcmp(args[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = args[++i];
+    } else if (std::strcmp(args[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = std::strtol(args[++i], nullptr, 10);
+    } else if (std::strcmp(args[i], "--tick-rate") == 0 && i + 1 < argc) {
+      tickRate = std::atoi(args[++i]);
+    } else if (std::strcmp(args[i], "--quiet") == 0) {
+      quiet = true;
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (!replayPath.empty()) {
+    // The recording's tick rate wins: physics only repeats at the same rate
+    Replay replay;
+    if (!loadReplay(replayPath, replay)) {
+      return 1;
+    }
+    if (repeat < 1) {
+      printUsage();
+      return 1;
+    }
+    return runReplay(replay, repeat, quiet);
+  }
+
+  std::vector<Shot> shots;
+  if (!loadShots(shotsPath, shots)) {
+    return 1;
+  }
+  if (shots.empty() || repeat < 1 || tickRate < 1) {
+    printUsage();
+    return 1;
+  }
+
+  SpatialGrid grid;
+  grid.build(level.objects.data(), level.objects.size());
+
+  long totalShots = 0, totalHoled = 0;
+  long long totalTicks = 0;
+  SDL_Rect ballRect = level.ballRect;
+  auto start = std::chrono::steady_clock::now();
+
+  for (long pass = 0; pass < repeat; ++pass) {
+    for (size_t i = 0; i < shots.size(); ++i) {
+      ShotOutcome outcome =
+          simulateShot(level, grid, ballRect, shots[i], tickRate);
+      ++totalShots;
+      totalTicks += outcome.ticks;
+
+      if (!quiet) {
+        std::cout << "shot " << totalShots << ": "
+                  << (outcome.holed         ? "holed"
+                      : outcome.outOfBounds ? "out"
+                                            : "rest")
+                  << " bounces=" << outcome.bounces
+                  << " ticks=" << outcome.ticks << " ball=("
+                  << outcome.finalBallRect.x << ","
+                  << outcome.finalBallRect.y << ")" << std::endl;
+      }
+
+      // A holed ball starts the level over for the next shot
+      if (outcome.holed) {
+        ++totalHoled;
+        ballRect = level.ballRect;
+      }
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "shots=" << totalShots << " holed=" << totalHoled
+            << " ticks=" << totalTicks << " elapsed=" << elapsed.count()
+            << "s shots/s=" << totalShots / std::max(elapsed.count(), 1e-9)
+            << std::endl;
+  return 0;
+}
+
+static void printBatchUsage() {
+  std::cerr << "usage: game --generate N [--seed S] [--level FILE] [--par]"
+               " [--quiet]"
+            << std::endl;
+}
+
+int runLevelBatch(int argc, char *args[]) {
+  // Generated levels keep the template's object sizes
+  Level level = defaultLevel();
+  long count = 0;
+  uint64_t seed = 1;
+  bool computeLevelPar = false;
+  bool quiet = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(args[i], "--generate") == 0 && i + 1 < argc) {
+      count = std::strtol(args[++i], nullptr, 10);
+    } else if (std::strcmp(args[i], "--seed") == 0 && i + 1 < argc) {
+      seed = std::strtoull(args[++i], nullptr, 10);
+    } else if (std::strcmp(args[i], "--level") == 0 && i + 1 < argc) {
+      if (!loadLevel(args[++i], level)) {
+        return 1;
+      }
+    } else if (std::strcmp(args[i], "--par") == 0) {
+      computeLevelPar = true;
+    } else if (std::strcmp(args[i], "--quiet") == 0) {
+      quiet = true;
+    } else {
+      printBatchUsage();
+      return 1;
+    }
+  }
+  if (count < 1) {
+    printBatchUsage();
+    return 1;
+  }
+
+  long generated = 0, failed = 0;
+  WorkPool pool;
+  SpatialGrid grid;
+  auto start = std::chrono::steady_clock::now();
+
+  for (long i = 0; i < count; ++i, ++seed) {
+    if (!generateLevel(seed, level)) {
+      std::cerr << "No playable layout for seed " << seed << std::endl;
+      ++failed;
+      continue;
+    }
+    ++generated;
+    if (computeLevelPar) {
+      grid.build(level.objects.data(), level.objects.size());
+      level.par = computePar(level, grid, pool);
+    }
+    if (!quiet) {
+      writeLevel(std::cout, level);
+      std::cout << "\n";
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cerr << "levels=" << generated << " failed=" << failed
+            << " elapsed=" << elapsed.count()
+            << "s levels/s=" << generated / std::max(elapsed.count(), 1e-9)
+            << std::endl;
+  return failed ? 1 : 0;
+}
+
+static void printBenchmarkUsage() {
+  std::cerr << "usage: game --ball-bench N [--level FILE] [--tick-rate HZ]"
+            << std::endl;
+}
+
+int runBallBenchmark(int argc, char *args[]) {
+  Level level = defaultLevel();
+  long count = 0;
+  int tickRate = DEFAULT_TICK_RATE;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(args[i], "--ball-bench") == 0 && i + 1 < argc) {
+      count = std::strtol(args[++i], nullptr, 10);
+    } else if (std::strcmp(args[i], "--level") == 0 && i + 1 < argc) {
+      if (!loadLevel(args[++i], level)) {
+        return 1;
+      }
+    } else if (std::strcmp(args[i], "--tick-rate") == 0 && i + 1 < argc) {
+      tickRate = std::atoi(args[++i]);
+    } else {
+      printBenchmarkUsage();
+      return 1;
+    }
+  }
+  if (count < 1 || tickRate < 1) {
+    printBenchmarkUsage();
+    return 1;
+  }
+
+  SpatialGrid grid;
+  grid.build(level.objects.data(), level.objects.size());
+  const float dt = 1.0f / tickRate;
+
+  // Every ball is a stroke from the level's start. Like the solver's tasks,
+  // consecutive balls share a direction and differ in power. Directions
+  // step by the golden angle so they never repeat.
+  std::vector<Ball> balls(count);
+  BallSystem system;
+  for (long i = 0; i < count; ++i) {
+    float angle = (i / 16) * 2.39996323f;
+    int targetX = level.ballRect.x + BALL_SIZE / 2 +
+                  static_cast<int>(std::cos(angle) * SOLVER_AIM_RADIUS);
+    int targetY = level.ballRect.y + BALL_SIZE / 2 +
+                  static_cast<int>(std::sin(angle) * SOLVER_AIM_RADIUS);
+    Uint32 pressDuration = MAX_PRESS_DURATION * (i % 16 + 1) / 16;
+
+    placeBall(balls[i], level.ballRect);
+    launchBall(balls[i], targetX, targetY, pressDuration);
+    int index = system.add(level.ballRect);
+    system.launch(index, targetX, targetY, pressDuration);
+  }
+
+  // Scalar path: one updateBallPosition call per moving ball per tick
+  std::vector<bool> holed(count, false);
+  long long scalarSteps = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < MAX_SHOT_TICKS; ++tick) {
+    bool moving = false;
+    for (long i = 0; i < count; ++i) {
+      if (holed[i] || (balls[i].velX == 0 && balls[i].velY == 0)) {
+        continue;
+      }
+      bool ballInHole = false;
+      float animationProgress = 0.0f;
+      int bounces = 0;
+      BallEvent event = updateBallPosition(
+          balls[i], false, level.objects.data(), grid, level.holeRect,
+          level.bounds, ballInHole, animationProgress, bounces, dt);
+      holed[i] = event == BALL_ENTERED_HOLE;
+      moving = true;
+      ++scalarSteps;
+    }
+    if (!moving) {
+      break;
+    }
+  }
+  std::chrono::duration<double> scalarElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  // Structure-of-arrays path: every ball steps every tick until all rest
+  std::vector<BallEvent> events(count);
+  long long systemSteps = 0;
+  start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < MAX_SHOT_TICKS && system.moving(); ++tick) {
+    system.step(level.objects.data(), grid, level.holeRect, level.bounds, dt,
+                events.data());
+    systemSteps += count;
+  }
+  std::chrono::duration<double> systemElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  long mismatches = 0;
+  for (long i = 0; i < count; ++i) {
+    Ball ball = system.ball(static_cast<int>(i));
+    if (ball.x != balls[i].x || ball.y != balls[i].y) {
+      ++mismatches;
+    }
+  }
+
+  double scalarRate = count / std::max(scalarElapsed.count(), 1e-9);
+  double systemRate = count / std::max(systemElapsed.count(), 1e-9);
+  std::cout << "balls=" << count << " simd_lanes=" << SIMD_LANES
+            << " scalar_steps=" << scalarSteps
+            << " soa_steps=" << systemSteps << std::endl;
+  std::cout << "scalar elapsed=" << scalarElapsed.count()
+            << "s balls/s=" << scalarRate << std::endl;
+  std::cout << "soa    elapsed=" << systemElapsed.count()
+            << "s balls/s=" << systemRate << std::endl;
+  std::cout << "speedup=" << systemRate / scalarRate
+            << " mismatches=" << mismatches << std::endl;
+  return mismatches ? 1 : 0;
+}
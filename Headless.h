@@ -0,0 +1,58 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "Level.h"
+#include "Physics.h"
+#include "SpatialGrid.h"
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+// Upper bound on ticks per stroke so a ball stuck bouncing can't hang a run
+const int MAX_SHOT_TICKS = 100000;
+
+// A single stroke: the point the player pulled towards, relative to the
+// ball centre, and how long the mouse button was held
+struct Shot {
+  int aimX;
+  int aimY;
+  Uint32 pressDuration;
+};
+
+struct ShotOutcome {
+  bool holed;
+  bool outOfBounds;
+  int bounces;
+  int ticks;
+  SDL_Rect finalBallRect;
+};
+
+// Reads one shot per line as "AIM_X AIM_Y PRESS_MS"; '-' reads stdin
+bool loadShots(const std::string &path, std::vector<Shot> &shots);
+
+// Plays a stroke from ball, released with the mouse at (targetX, targetY),
+// until the ball rests, drops or leaves the course, stepping physics at
+// tickRate. ball is left where it stopped, exactly as the game leaves it.
+ShotOutcome simulateShot(const Level &level, const SpatialGrid &grid,
+                         Ball &ball, int targetX, int targetY,
+                         Uint32 pressDuration, int tickRate);
+
+// Plays a stroke from ballRect until the ball rests, drops or leaves the
+// course, stepping physics at tickRate. ballRect is left where the ball
+// stopped. grid must index level.objects.
+ShotOutcome simulateShot(const Level &level, const SpatialGrid &grid,
+                         SDL_Rect &ballRect, const Shot &shot, int tickRate);
+
+// Entry point for `game --headless`; never touches video or audio
+int runHeadless(int argc, char *args[]);
+
+// Entry point for `game --generate N`: writes N generated levels, one per
+// consecutive seed, to stdout in the loadLevel format
+int runLevelBatch(int argc, char *args[]);
+
+// Entry point for `game --ball-bench N`: plays N strokes through both
+// updateBallPosition and BallSystem, reports balls/s for each and checks
+// that they end in the same places
+int runBallBenchmark(int argc, char *args[]);
+
+#endif
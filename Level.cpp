@@ -0,0 +1,91 @@
+#include "Level.h"
+#include "Physics.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+Level defaultLevel() {
+  Level level;
+  level.objects = {
+      {300, 200, 70, 40}, {350, 100, 80, 45}, {600, 450, 100, 60},
+      {600, 200, 50, 50}, {250, 250, 55, 55}, {300, 400, 50, 50},
+      {800, 310, 95, 95}, {750, 100, 95, 95}, {480, 410, 50, 50},
+      {150, 180, 80, 45}, {480, 160, 40, 40}, {100, 400, 100, 100},
+  };
+  level.ballRect = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, BALL_SIZE, BALL_SIZE};
+  level.holeRect = {90, 280, HOLE_SIZE, HOLE_SIZE};
+  level.bounds = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+  level.seed = 0;
+  level.par = 0;
+  return level;
+}
+
+bool loadLevel(const std::string &path, Level &level) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Unable to open level " << path << std::endl;
+    return false;
+  }
+
+  level.objects.clear();
+  level.seed = 0;
+  level.par = 0;
+  level.ballRect = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, BALL_SIZE, BALL_SIZE};
+  level.holeRect = {0, 0, HOLE_SIZE, HOLE_SIZE};
+  level.bounds = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+  bool hasHole = false;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    std::istringstream in(line);
+    std::string kind;
+    if (!(in >> kind) || kind[0] == '#') {
+      continue;
+    }
+
+    SDL_Rect rect = {0, 0, 0, 0};
+    if (kind == "ball" && in >> rect.x >> rect.y) {
+      level.ballRect = {rect.x, rect.y, BALL_SIZE, BALL_SIZE};
+    } else if (kind == "hole" && in >> rect.x >> rect.y) {
+      level.holeRect = {rect.x, rect.y, HOLE_SIZE, HOLE_SIZE};
+      hasHole = true;
+    } else if (kind == "object" && in >> rect.x >> rect.y >> rect.w >> rect.h) {
+      level.objects.push_back(rect);
+    } else if (kind == "par" && in >> level.par) {
+      // Written by `game --generate N --par`
+    } else if (kind == "size" && in >> rect.w >> rect.h && rect.w > 0 &&
+               rect.h > 0) {
+      level.bounds = {0, 0, rect.w, rect.h};
+    } else {
+      std::cerr << path << ":" << lineNumber << ": bad level entry: " << line
+                << std::endl;
+      return false;
+    }
+  }
+
+  if (!hasHole) {
+    std::cerr << path << ": level has no hole" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void writeLevel(std::ostream &out, const Level &level) {
+  if (level.seed) {
+    out << "# seed " << level.seed << "\n";
+  }
+  if (level.par) {
+    out << "par " << level.par << "\n";
+  }
+  if (level.bounds.w != SCREEN_WIDTH || level.bounds.h != SCREEN_HEIGHT) {
+    out << "size " << level.bounds.w << " " << level.bounds.h << "\n";
+  }
+  out << "ball " << level.ballRect.x << " " << level.ballRect.y << "\n";
+  out << "hole " << level.holeRect.x << " " << level.holeRect.y << "\n";
+  for (const SDL_Rect &object : level.objects) {
+    out << "object " << object.x << " " << object.y << " " << object.w << " "
+        << object.h << "\n";
+  }
+}
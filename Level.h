@@ -0,0 +1,43 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <SDL.h>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Size of a generated course in screens, across and down
+struct CourseSize {
+  int columns;
+  int rows;
+};
+
+const CourseSize SINGLE_SCREEN = {1, 1};
+
+// A course layout: obstacles, where the ball starts and where the hole is
+struct Level {
+  std::vector<SDL_Rect> objects;
+  SDL_Rect ballRect;
+  SDL_Rect holeRect;
+  // Playfield; a ball that leaves it is out of bounds. One screen unless
+  // the course scrolls.
+  SDL_Rect bounds;
+  uint64_t seed; // Generator seed, or 0 for hand-made layouts
+  int par;       // Strokes the solver needed, or 0 if not known
+};
+
+Level defaultLevel();
+
+// Reads a plain-text layout, one entry per line:
+//   ball X Y
+//   hole X Y
+//   object X Y W H
+//   par N
+//   size W H      (playfield, if not one screen)
+// Blank lines and lines starting with '#' are ignored.
+bool loadLevel(const std::string &path, Level &level);
+// Writes level in the format loadLevel reads
+void writeLevel(std::ostream &out, const Level &level);
+
+#endif
@@ -0,0 +1,184 @@
+#include "LevelGenerator.h"
+#include "Random.h"
+#include <algorithm>
+#include <vector>
+
+// Range of lattice indices whose ball rect overlaps [start, start + size)
+// along one axis, clamped to the lattice
+static void latticeRange(int start, int size, int count, int &first,
+                         int &last) {
+  // A ball at p overlaps when start - BALL_SIZE < p < start + size
+  int low = start - BALL_SIZE;
+  first = low < 0 ? 0 : low / REACH_STEP + 1;
+  int high = start + size;
+  last = high <= 0 ? -1 : (high - 1) / REACH_STEP;
+  last = std::min(last, count - 1);
+}
+
+bool isHoleReachable(const Level &level) {
+  // Lattice of ball top-left positions covering the playfield, relative to
+  // its corner
+  const SDL_Rect &bounds = level.bounds;
+  const int columns = (bounds.w - BALL_SIZE) / REACH_STEP + 1;
+  const int rows = (bounds.h - BALL_SIZE) / REACH_STEP + 1;
+  if (columns < 1 || rows < 1) {
+    return false;
+  }
+
+  std::vector<char> blocked(static_cast<size_t>(columns) * rows, 0);
+  for (const SDL_Rect &object : level.objects) {
+    int firstX, lastX, firstY, lastY;
+    latticeRange(object.x - bounds.x, object.w, columns, firstX, lastX);
+    latticeRange(object.y - bounds.y, object.h, rows, firstY, lastY);
+    for (int y = firstY; y <= lastY; ++y) {
+      std::fill(blocked.begin() + y * columns + firstX,
+                blocked.begin() + y * columns + lastX + 1, 1);
+    }
+  }
+
+  int holeFirstX, holeLastX, holeFirstY, holeLastY;
+  latticeRange(level.holeRect.x - bounds.x, level.holeRect.w, columns,
+               holeFirstX, holeLastX);
+  latticeRange(level.holeRect.y - bounds.y, level.holeRect.h, rows,
+               holeFirstY, holeLastY);
+
+  // Start from the lattice points around the ball that are free; the ball
+  // is less than a step away from each of them
+  std::vector<int> frontier;
+  int startX = (level.ballRect.x - bounds.x) / REACH_STEP;
+  int startY = (level.ballRect.y - bounds.y) / REACH_STEP;
+  for (int y = startY; y <= startY + 1 && y < rows; ++y) {
+    for (int x = startX; x <= startX + 1 && x < columns; ++x) {
+      if (x >= 0 && y >= 0 && !blocked[y * columns + x]) {
+        blocked[y * columns + x] = 1;
+        frontier.push_back(y * columns + x);
+      }
+    }
+  }
+
+  // Breadth-first flood fill, four-connected so no step can clip a corner
+  for (size_t next = 0; next < frontier.size(); ++next) {
+    int x = frontier[next] % columns;
+    int y = frontier[next] / columns;
+    if (x >= holeFirstX && x <= holeLastX && y >= holeFirstY &&
+        y <= holeLastY) {
+      return true;
+    }
+
+    const int neighbours[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for (const auto &offset : neighbours) {
+      int nx = x + offset[0], ny = y + offset[1];
+      if (nx < 0 || ny < 0 || nx >= columns || ny >= rows ||
+          blocked[ny * columns + nx]) {
+        continue;
+      }
+      blocked[ny * columns + nx] = 1;
+      frontier.push_back(ny * columns + nx);
+    }
+  }
+  return false;
+}
+
+SDL_Rect generationArea(const SDL_Rect &bounds) {
+  return {bounds.x + GENERATION_MARGIN_LEFT, bounds.y + GENERATION_MARGIN_TOP,
+          bounds.w - GENERATION_MARGIN_LEFT - GENERATION_MARGIN_RIGHT,
+          bounds.h - GENERATION_MARGIN_TOP - GENERATION_MARGIN_BOTTOM};
+}
+
+bool generateLevel(uint64_t seed, Level &level) {
+  // Cells are as large as the largest rect, so anything fits in any cell,
+  // and the ball fits even after snapping to the reachability lattice
+  int cellSize = std::max(BALL_SIZE + REACH_STEP, HOLE_SIZE);
+  for (const SDL_Rect &object : level.objects) {
+    cellSize = std::max(cellSize, std::max(object.w, object.h));
+  }
+  const SDL_Rect area = generationArea(level.bounds);
+  const int columns = std::max(0, area.w / cellSize);
+  const int rows = std::max(0, area.h / cellSize);
+  const size_t numCells = static_cast<size_t>(columns) * rows;
+  if (numCells < level.objects.size() + 2) {
+    return false;
+  }
+
+  std::vector<int> cells(numCells);
+  // Derives each attempt's seed so attempt N of a seed is always the same
+  Random attempts(seed);
+
+  for (int attempt = 0; attempt < MAX_GENERATION_ATTEMPTS; ++attempt) {
+    Random random(attempts.next());
+
+    // Shuffle the cells and hand them out in order: one per object, then
+    // the ball, then the first remaining cell far enough away for the hole
+    for (size_t i = 0; i < numCells; ++i) {
+      cells[i] = static_cast<int>(i);
+    }
+    for (size_t i = numCells - 1; i > 0; --i) {
+      std::swap(cells[i], cells[random.below(static_cast<uint32_t>(i + 1))]);
+    }
+
+    // Positions are multiples of alignment from the level's bounds
+    auto placeInCell = [&](int cell, SDL_Rect &rect, int alignment) {
+      int cellX = area.x + (cell % columns) * cellSize;
+      int cellY = area.y + (cell / columns) * cellSize;
+      int firstX = level.bounds.x +
+                   (cellX - level.bounds.x + alignment - 1) / alignment *
+                       alignment;
+      int firstY = level.bounds.y +
+                   (cellY - level.bounds.y + alignment - 1) / alignment *
+                       alignment;
+      rect.x = firstX +
+               random.below((cellX + cellSize - rect.w - firstX) / alignment +
+                            1) *
+                   alignment;
+      rect.y = firstY +
+               random.below((cellY + cellSize - rect.h - firstY) / alignment +
+                            1) *
+                   alignment;
+    };
+
+    size_t cell = 0;
+    for (SDL_Rect &object : level.objects) {
+      placeInCell(cells[cell++], object, 1);
+    }
+
+    // The ball sits on the reachability lattice so its start is exact
+    level.ballRect = {0, 0, BALL_SIZE, BALL_SIZE};
+    placeInCell(cells[cell++], level.ballRect, REACH_STEP);
+
+    level.holeRect = {0, 0, HOLE_SIZE, HOLE_SIZE};
+    bool holePlaced = false;
+    for (; cell < numCells && !holePlaced; ++cell) {
+      placeInCell(cells[cell], level.holeRect, 1);
+      int dx = (level.holeRect.x + HOLE_SIZE / 2) -
+               (level.ballRect.x + BALL_SIZE / 2);
+      int dy = (level.holeRect.y + HOLE_SIZE / 2) -
+               (level.ballRect.y + BALL_SIZE / 2);
+      holePlaced = dx * dx + dy * dy >= MIN_HOLE_DISTANCE * MIN_HOLE_DISTANCE;
+    }
+
+    if (holePlaced && isHoleReachable(level)) {
+      level.seed = seed;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool levelFromSeed(uint64_t seed, Level &level, CourseSize size) {
+  level = defaultLevel();
+  if (seed == 0) {
+    return true;
+  }
+
+  const int columns = std::max(1, size.columns);
+  const int rows = std::max(1, size.rows);
+  level.bounds = {0, 0, SCREEN_WIDTH * columns, SCREEN_HEIGHT * rows};
+
+  // Every screen gets as many obstacles as the built-in course has
+  const size_t perScreen = level.objects.size();
+  level.objects.resize(perScreen * columns * rows);
+  for (size_t i = perScreen; i < level.objects.size(); ++i) {
+    level.objects[i] = level.objects[i % perScreen];
+  }
+  return generateLevel(seed, level);
+}
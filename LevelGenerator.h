@@ -0,0 +1,45 @@
+#ifndef LEVELGENERATOR_H
+#define LEVELGENERATOR_H
+
+#include "Level.h"
+#include "Physics.h"
+#include <SDL.h>
+#include <cstdint>
+
+// Margins of the playfield the generator leaves empty; on one screen they
+// leave {100, 100, 800, 400} to place objects, the ball and the hole in
+const int GENERATION_MARGIN_LEFT = 100;
+const int GENERATION_MARGIN_TOP = 100;
+const int GENERATION_MARGIN_RIGHT = 60;
+const int GENERATION_MARGIN_BOTTOM = 40;
+// Layouts tried per seed before giving up; each attempt is O(objects)
+const int MAX_GENERATION_ATTEMPTS = 64;
+// Closest the hole may be generated to the ball, centre to centre
+const int MIN_HOLE_DISTANCE = 200;
+// Spacing of the ball positions the reachability search steps through
+const int REACH_STEP = BALL_SIZE / 2;
+
+// Lays out level.objects (keeping their sizes), the ball and the hole from
+// seed. The same seed always gives the same level. Objects are jittered
+// inside distinct cells of a grid over generationArea(level.bounds), so they
+// never overlap and no placement loop can spin; a layout whose hole can't be
+// reached is retried with a derived seed. Returns false, leaving level
+// unspecified, if none of MAX_GENERATION_ATTEMPTS layouts is valid or the
+// objects can't fit in the area at all.
+bool generateLevel(uint64_t seed, Level &level);
+
+// Part of bounds the generator places things in
+SDL_Rect generationArea(const SDL_Rect &bounds);
+
+// The level a session refers to by seed: 0 is the built-in course, anything
+// else is generated over size screens with the built-in course's object
+// sizes, repeated once per screen
+bool levelFromSeed(uint64_t seed, Level &level,
+                   CourseSize size = SINGLE_SCREEN);
+
+// True if the ball can get from its start to the hole through free space.
+// Since a stroke can be arbitrarily short and in any direction, connected
+// free space means the hole can be reached in some number of strokes.
+bool isHoleReachable(const Level &level);
+
+#endif
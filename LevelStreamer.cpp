@@ -0,0 +1,130 @@
+#include "LevelStreamer.h"
+#include "LevelGenerator.h"
+#include "Solver.h"
+#include <algorithm>
+#include <utility>
+
+LevelStreamer::LevelStreamer(CourseSize courseSize)
+    : stopping(false), courseSize(courseSize), hasRequest(false),
+      requestSeed(0), busy(false), busySeed(0), hasResult(false),
+      resultSeed(0), resultPlayable(false), resultParSolved(false),
+      hasTaken(false), takenSeed(0), takenParSolved(false), takenPar(0),
+      cancelPar(false), pool(std::max(1u, std::thread::hardware_concurrency() / 2)) {
+  thread = std::thread(&LevelStreamer::work, this);
+}
+
+LevelStreamer::~LevelStreamer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    cancelPar = true;
+  }
+  requested.notify_all();
+  thread.join();
+}
+
+void LevelStreamer::request(uint64_t seed) {
+  std::lock_guard<std::mutex> lock(mutex);
+  requestLocked(seed);
+}
+
+void LevelStreamer::requestLocked(uint64_t seed) {
+  if ((hasResult && resultSeed == seed) || (busy && busySeed == seed) ||
+      (hasRequest && requestSeed == seed)) {
+    return;
+  }
+  hasRequest = true;
+  requestSeed = seed;
+  requested.notify_one();
+}
+
+bool LevelStreamer::take(uint64_t seed, Level &level, SpatialGrid &grid) {
+  std::unique_lock<std::mutex> lock(mutex);
+  requestLocked(seed);
+  if (!hasResult || resultSeed != seed) {
+    // Whatever par is being solved, it is holding up a level in play
+    cancelPar = true;
+  }
+  prepared.wait(lock, [&] { return hasResult && resultSeed == seed; });
+  hasResult = false;
+  if (!resultPlayable) {
+    return false;
+  }
+  level = std::move(resultLevel);
+  grid = std::move(resultGrid);
+  hasTaken = true;
+  takenSeed = seed;
+  takenParSolved = resultParSolved;
+  takenPar = level.par;
+  return true;
+}
+
+bool LevelStreamer::takePar(uint64_t seed, int &par) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!hasTaken || takenSeed != seed || !takenParSolved) {
+    return false;
+  }
+  takenParSolved = false;
+  par = takenPar;
+  return true;
+}
+
+void LevelStreamer::finishPar(uint64_t seed, int par) {
+  if (hasResult && resultSeed == seed) {
+    resultLevel.par = par;
+    resultParSolved = true;
+  } else if (hasTaken && takenSeed == seed) {
+    takenPar = par;
+    takenParSolved = true;
+  }
+}
+
+void LevelStreamer::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    requested.wait(lock, [&] { return stopping || hasRequest; });
+    if (stopping) {
+      return;
+    }
+    hasRequest = false;
+    busy = true;
+    busySeed = requestSeed;
+    const uint64_t seed = busySeed;
+    lock.unlock();
+
+    Level level;
+    SpatialGrid grid;
+    bool playable = levelFromSeed(seed, level, courseSize);
+    if (playable) {
+      grid.build(level.objects.data(), level.objects.size());
+    }
+    // Three strokes rarely cross a scrolling course, and proving that
+    // takes the solver far longer than a level is played for
+    bool solvePar = playable && level.bounds.w <= SCREEN_WIDTH &&
+                    level.bounds.h <= SCREEN_HEIGHT;
+
+    // The layout goes out now, and a copy stays behind for the solver. A
+    // request for another level already waiting goes first, and this par
+    // stays unknown; the wait may be a take() that cancelled it.
+    lock.lock();
+    solvePar = solvePar && !stopping && !(hasRequest && requestSeed != seed);
+    busy = false;
+    hasResult = true;
+    resultSeed = seed;
+    resultPlayable = playable;
+    resultParSolved = !solvePar;
+    resultLevel = level;
+    resultGrid = grid;
+    prepared.notify_all();
+    if (!solvePar) {
+      continue;
+    }
+    cancelPar = false;
+    lock.unlock();
+
+    int par = computePar(level, grid, pool, &cancelPar);
+
+    lock.lock();
+    finishPar(seed, par);
+  }
+}
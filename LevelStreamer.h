@@ -0,0 +1,80 @@
+#ifndef LEVELSTREAMER_H
+#define LEVELSTREAMER_H
+
+#include "Level.h"
+#include "SpatialGrid.h"
+#include "WorkPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Prepares levels on a background thread while the current one is played:
+// generates and validates the layout, indexes its objects and then solves
+// its par. Changing level then only swaps the prepared one in. The layout
+// is handed over as soon as it is ready; its par follows when the solver
+// is done. Generated levels span courseSize screens.
+class LevelStreamer {
+public:
+  explicit LevelStreamer(CourseSize courseSize = SINGLE_SCREEN);
+  ~LevelStreamer();
+  LevelStreamer(const LevelStreamer &) = delete;
+  LevelStreamer &operator=(const LevelStreamer &) = delete;
+
+  // Starts preparing the level for seed, in place of any earlier request
+  // that hasn't been started yet
+  void request(uint64_t seed);
+  // Moves the level for seed and its grid out of the streamer, waiting if
+  // its layout is still being prepared and preparing it first if it was
+  // never requested. Never waits for a par; the par search for another
+  // level that would hold it up is given up or never started, and that
+  // level's par is left unknown. Returns false if seed has no playable
+  // layout.
+  bool take(uint64_t seed, Level &level, SpatialGrid &grid);
+  // Sets par to the par of the level last taken, if that was seed's and its
+  // search has finished since; 0 means not known. Returns true only once
+  // per level.
+  bool takePar(uint64_t seed, int &par);
+
+private:
+  void work();
+  // Call with mutex held
+  void requestLocked(uint64_t seed);
+  // Hands a finished par to whichever of the prepared or the taken level it
+  // belongs to, if either. Call with mutex held.
+  void finishPar(uint64_t seed, int par);
+
+  std::mutex mutex;
+  std::condition_variable requested;
+  std::condition_variable prepared;
+  bool stopping;
+  const CourseSize courseSize;
+
+  bool hasRequest;
+  uint64_t requestSeed;
+  bool busy;
+  uint64_t busySeed;
+
+  bool hasResult;
+  uint64_t resultSeed;
+  bool resultPlayable;
+  bool resultParSolved;
+  Level resultLevel; // With its par once resultParSolved
+  SpatialGrid resultGrid;
+
+  bool hasTaken;
+  uint64_t takenSeed;
+  bool takenParSolved;
+  int takenPar;
+
+  // Makes the streaming thread give up the par it is solving
+  std::atomic<bool> cancelPar;
+
+  // Used only by the streaming thread. Half the cores, so preparing a level
+  // doesn't starve the frame it overlaps.
+  WorkPool pool;
+  std::thread thread;
+};
+
+#endif
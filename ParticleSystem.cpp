@@ -0,0 +1,170 @@
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+ParticleSystem::ParticleSystem()
+    : x(MAX_PARTICLES), y(MAX_PARTICLES), velX(MAX_PARTICLES),
+      velY(MAX_PARTICLES), life(MAX_PARTICLES), fade(MAX_PARTICLES),
+      sizes(MAX_PARTICLES), drag(MAX_PARTICLES), colors(MAX_PARTICLES),
+      count(0), trailing(false), trailX(0), trailY(0), random(1) {
+  vertices.reserve(MAX_PARTICLES * 4);
+  indices.resize(MAX_PARTICLES * 6);
+  const int quad[6] = {0, 1, 2, 0, 2, 3};
+  for (int i = 0; i < MAX_PARTICLES; ++i) {
+    for (int corner = 0; corner < 6; ++corner) {
+      indices[i * 6 + corner] = i * 4 + quad[corner];
+    }
+  }
+}
+
+void ParticleSystem::clear() {
+  count = 0;
+  trailing = false;
+}
+
+void ParticleSystem::spawn(float x, float y, float velX, float velY,
+                           float life, float size, float drag,
+                           SDL_Color color) {
+  if (count == MAX_PARTICLES) {
+    return;
+  }
+  this->x[count] = x;
+  this->y[count] = y;
+  this->velX[count] = velX;
+  this->velY[count] = velY;
+  this->life[count] = life;
+  fade[count] = 1.0f / life;
+  sizes[count] = size;
+  this->drag[count] = drag;
+  colors[count] = color;
+  ++count;
+}
+
+void ParticleSystem::dust(float x, float y, float strength) {
+  const SDL_Color sand = {214, 200, 160, 220};
+  int particles = 6 + static_cast<int>(18 * strength);
+  for (int i = 0; i < particles; ++i) {
+    float angle = random.unit() * 2.0f * static_cast<float>(M_PI);
+    float speed = (20.0f + 60.0f * random.unit()) * (0.5f + strength);
+    spawn(x, y, std::cos(angle) * speed, std::sin(angle) * speed,
+          0.3f + 0.3f * random.unit(), 2.0f + 2.0f * random.unit(), 6.0f,
+          sand);
+  }
+}
+
+void ParticleSystem::confetti(float x, float y) {
+  const SDL_Color palette[] = {{255, 82, 82, 255},  {255, 214, 64, 255},
+                               {92, 214, 92, 255},  {72, 160, 255, 255},
+                               {200, 110, 255, 255}};
+  const int paletteSize = sizeof(palette) / sizeof(palette[0]);
+  for (int i = 0; i < 160; ++i) {
+    float angle = random.unit() * 2.0f * static_cast<float>(M_PI);
+    float speed = 80.0f + 160.0f * random.unit();
+    spawn(x, y, std::cos(angle) * speed, std::sin(angle) * speed,
+          1.0f + 0.6f * random.unit(), 3.0f + 2.0f * random.unit(), 2.5f,
+          palette[random.below(paletteSize)]);
+  }
+}
+
+void ParticleSystem::trail(float x, float y) {
+  const SDL_Color speck = {255, 255, 255, 150};
+  if (!trailing) {
+    trailing = true;
+    trailX = x;
+    trailY = y;
+    return;
+  }
+  float dx = x - trailX, dy = y - trailY;
+  float distance = std::sqrt(dx * dx + dy * dy);
+  if (distance < TRAIL_SPACING) {
+    return;
+  }
+  // Evenly spaced from the last speck, so the trail doesn't bunch up or
+  // thin out with the frame rate
+  int specks = static_cast<int>(distance / TRAIL_SPACING);
+  float stepX = dx / distance * TRAIL_SPACING;
+  float stepY = dy / distance * TRAIL_SPACING;
+  for (int i = 0; i < specks; ++i) {
+    trailX += stepX;
+    trailY += stepY;
+    spawn(trailX, trailY, 0.0f, 0.0f, 0.35f, 2.0f, 0.0f, speck);
+  }
+}
+
+void ParticleSystem::update(float dt) {
+  const Lanes zero = lanesBroadcast(0.0f);
+  const Lanes one = lanesBroadcast(1.0f);
+  const Lanes step = lanesBroadcast(dt);
+
+  // The arrays are a whole number of lane groups long, so the last group can
+  // run past count into dead slots; what it writes there is never read
+  for (size_t first = 0; first < count; first += SIMD_LANES) {
+    Lanes damping = max(zero, one - lanesLoad(&drag[first]) * step);
+    Lanes vx = lanesLoad(&velX[first]) * damping;
+    Lanes vy = lanesLoad(&velY[first]) * damping;
+    lanesStore(&velX[first], vx);
+    lanesStore(&velY[first], vy);
+    lanesStore(&x[first], lanesLoad(&x[first]) + vx * step);
+    lanesStore(&y[first], lanesLoad(&y[first]) + vy * step);
+    lanesStore(&life[first], lanesLoad(&life[first]) - step);
+  }
+
+  // Order doesn't matter, so each dead particle is replaced by the last one
+  for (size_t i = 0; i < count;) {
+    if (life[i] > 0) {
+      ++i;
+      continue;
+    }
+    size_t last = --count;
+    x[i] = x[last];
+    y[i] = y[last];
+    velX[i] = velX[last];
+    velY[i] = velY[last];
+    life[i] = life[last];
+    fade[i] = fade[last];
+    sizes[i] = sizes[last];
+    drag[i] = drag[last];
+    colors[i] = colors[last];
+  }
+}
+
+void ParticleSystem::draw(SDL_Renderer *renderer, const SDL_Rect &camera) {
+  vertices.clear();
+  for (size_t i = 0; i < count; ++i) {
+    float half = sizes[i] / 2;
+    float left = x[i] - camera.x - half;
+    float top = y[i] - camera.y - half;
+    if (left + sizes[i] < 0 || top + sizes[i] < 0 || left > camera.w ||
+        top > camera.h) {
+      continue;
+    }
+
+    SDL_Color color = colors[i];
+    color.a = static_cast<Uint8>(color.a * std::min(1.0f, life[i] * fade[i]));
+    const float cornerX[4] = {left, left + sizes[i], left + sizes[i], left};
+    const float cornerY[4] = {top, top, top + sizes[i], top + sizes[i]};
+    for (int corner = 0; corner < 4; ++corner) {
+      SDL_Vertex vertex;
+      vertex.position.x = cornerX[corner];
+      vertex.position.y = cornerY[corner];
+      vertex.color = color;
+      vertex.tex_coord.x = vertex.tex_coord.y = 0.0f;
+      vertices.push_back(vertex);
+    }
+  }
+  if (vertices.empty()) {
+    return;
+  }
+
+  // Untextured geometry blends with the renderer's draw blend mode
+  SDL_BlendMode blendMode;
+  SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  int quads = static_cast<int>(vertices.size() / 4);
+  SDL_RenderGeometry(renderer, nullptr, vertices.data(),
+                     static_cast<int>(vertices.size()), indices.data(),
+                     quads * 6);
+  Profiler::countDrawCalls();
+  SDL_SetRenderDrawBlendMode(renderer, blendMode);
+}
@@ -0,0 +1,65 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+#include "Random.h"
+#include "Simd.h"
+#include <SDL.h>
+#include <cstddef>
+#include <vector>
+
+// Most particles alive at once; spawns beyond it are dropped
+const int MAX_PARTICLES = 4096;
+// Distance between the specks of a ball's trail
+const float TRAIL_SPACING = 6.0f;
+
+// Dust, trails and confetti, purely for show. Particles live in fixed-size
+// float arrays (structure of arrays), so spawning never allocates and
+// update() moves SIMD_LANES of them at once; draw() sends every visible one
+// in a single untextured geometry call. Coordinates are course pixels,
+// velocities pixels per second. Use from the render thread only.
+class ParticleSystem {
+public:
+  ParticleSystem();
+
+  void clear();
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // Dust kicked up where the ball struck something; strength is 0 to 1
+  void dust(float x, float y, float strength);
+  // Confetti thrown out of the hole at (x, y)
+  void confetti(float x, float y);
+  // Leaves specks along the ball's path up to (x, y), continuing from the
+  // previous call unless endTrail() came in between
+  void trail(float x, float y);
+  void endTrail() { trailing = false; }
+
+  // Slows, moves and ages every particle by dt seconds, then drops the ones
+  // whose life has run out
+  void update(float dt);
+  // Draws the particles inside camera, fading each out over its life
+  void draw(SDL_Renderer *renderer, const SDL_Rect &camera);
+
+private:
+  static_assert(MAX_PARTICLES % SIMD_LANES == 0,
+                "Particle arrays are updated in whole lane groups");
+
+  void spawn(float x, float y, float velX, float velY, float life,
+             float size, float drag, SDL_Color color);
+
+  // MAX_PARTICLES long; only the first count are alive. fade is the
+  // reciprocal of the particle's full life, and drag the fraction of its
+  // speed it loses per second.
+  std::vector<float> x, y, velX, velY, life, fade, sizes, drag;
+  std::vector<SDL_Color> colors;
+  size_t count;
+
+  bool trailing;
+  float trailX, trailY; // Where the last speck was left
+
+  Random random;
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices; // Every quad's, filled once
+};
+
+#endif
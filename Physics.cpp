@@ -0,0 +1,211 @@
+#include "Physics.h"
+#include <algorithm>
+#include <cmath>
+
+void placeBall(Ball &ball, const SDL_Rect &rect) {
+  ball.x = static_cast<float>(rect.x);
+  ball.y = static_cast<float>(rect.y);
+  ball.w = rect.w;
+  ball.h = rect.h;
+  ball.velX = ball.velY = 0;
+}
+
+void launchBall(Ball &ball, int targetX, int targetY, Uint32 pressDuration) {
+  if (pressDuration > MAX_PRESS_DURATION) {
+    pressDuration = MAX_PRESS_DURATION;
+  }
+
+  float directionX = targetX - (ball.x + ball.w / 2);
+  float directionY = targetY - (ball.y + ball.h / 2);
+  float length = sqrt(directionX * directionX + directionY * directionY);
+
+  if (length) {
+    directionX /= length;
+    directionY /= length;
+  }
+
+  // The ball travels away from the point the player pulled towards. The old
+  // per-frame loop moved the ball by its velocity twice each frame, so the
+  // launch speed is doubled to keep shots the same length.
+  ball.velX = -directionX * (pressDuration / 5.0f);
+  ball.velY = -directionY * (pressDuration / 5.0f);
+}
+
+bool sweepBall(const Ball &ball, float moveX, float moveY,
+               const SDL_Rect &rect, float &hitTime, float &normalX,
+               float &normalY) {
+  // Entry and exit times along one axis of the ball's box against rect's
+  auto axisTimes = [](float position, int size, float move, int rectPosition,
+                      int rectSize, float &entry, float &exit) {
+    if (move > 0) {
+      entry = (rectPosition - (position + size)) / move;
+      exit = (rectPosition + rectSize - position) / move;
+    } else if (move < 0) {
+      entry = (rectPosition + rectSize - position) / move;
+      exit = (rectPosition - (position + size)) / move;
+    } else if (position + size <= rectPosition ||
+               position >= rectPosition + rectSize) {
+      return false; // Not moving on this axis and not overlapping on it
+    } else {
+      entry = -INFINITY;
+      exit = INFINITY;
+    }
+    return true;
+  };
+
+  float entryX, exitX, entryY, exitY;
+  if (!axisTimes(ball.x, ball.w, moveX, rect.x, rect.w, entryX, exitX) ||
+      !axisTimes(ball.y, ball.h, moveY, rect.y, rect.h, entryY, exitY)) {
+    return false;
+  }
+
+  float entry = std::max(entryX, entryY);
+  float exit = std::min(exitX, exitY);
+  if (entry >= exit || exit <= 0 || entry > 1) {
+    return false;
+  }
+
+  if (entry < 0) {
+    // Already overlapping: there is no face to report
+    hitTime = 0;
+    normalX = normalY = 0;
+  } else if (entryX >= entryY) {
+    // The axis entered last is the face that was hit
+    hitTime = entry;
+    normalX = moveX > 0 ? -1.0f : 1.0f;
+    normalY = 0;
+  } else {
+    hitTime = entry;
+    normalX = 0;
+    normalY = moveY > 0 ? -1.0f : 1.0f;
+  }
+  return true;
+}
+
+void reflectBallOffObject(Ball &ball, const SDL_Rect &objectRect,
+                          float normalX, float normalY) {
+  // Sit the ball exactly on the face it hit so float error can't leave it
+  // inside the object
+  if (normalX > 0) {
+    ball.x = objectRect.x + objectRect.w;
+  } else if (normalX < 0) {
+    ball.x = objectRect.x - ball.w;
+  }
+  if (normalY > 0) {
+    ball.y = objectRect.y + objectRect.h;
+  } else if (normalY < 0) {
+    ball.y = objectRect.y - ball.h;
+  }
+
+  float along = ball.velX * normalX + ball.velY * normalY;
+  ball.velX -= 2 * along * normalX;
+  ball.velY -= 2 * along * normalY;
+}
+
+BallEvent updateBallPosition(Ball &ball, bool moveBall,
+                             const SDL_Rect objects[],
+                             const SpatialGrid &grid,
+                             const SDL_Rect &holeRect, const SDL_Rect &bounds,
+                             bool &ballInHole, float &animationProgress,
+                             int &bounceCount, float dt) {
+  // Number of reference ticks this step covers
+  const float ticks = dt * REFERENCE_TICK_RATE;
+
+  if (ballInHole) {
+    // Animate the ball falling into the hole
+    animationProgress += 0.05f * ticks; // Adjust speed of animation
+    if (ball.w >= 12) {
+      // Ball falls and shrinks
+      ball.w = static_cast<int>(BALL_SIZE * (0.8f - animationProgress));
+      ball.h = static_cast<int>(BALL_SIZE * (0.8f - animationProgress));
+      return BALL_NONE;
+    }
+
+    ballInHole = false;
+    return BALL_SETTLED_IN_HOLE;
+  }
+
+  // Distance covered this step per unit of (post-friction) velocity. Friction
+  // is a per-reference-tick factor, so its decay is integrated over the step
+  // rather than applied once per call.
+  float travel = ticks;
+  if (!moveBall) {
+    float friction = std::pow(FRICTION, ticks);
+    travel = (1.0f / friction - 1.0f) / -std::log(FRICTION);
+    ball.velX *= friction;
+    ball.velY *= friction;
+    if (std::fabs(ball.velX) < 0.1f)
+      ball.velX = 0;
+    if (std::fabs(ball.velY) < 0.1f)
+      ball.velY = 0;
+  }
+
+  // Resolve contacts in the order they happen along the path, spending the
+  // rest of the step's motion after each bounce
+  BallEvent event = BALL_NONE;
+  float remaining = 1.0f;
+  for (int contact = 0; contact < MAX_CONTACTS_PER_STEP && remaining > 0;
+       ++contact) {
+    float moveX = ball.velX * travel * remaining;
+    float moveY = ball.velY * travel * remaining;
+    if (moveX == 0 && moveY == 0) {
+      break;
+    }
+
+    // Only objects near the swept box of this move can be hit
+    SDL_Rect sweptBounds = {
+        static_cast<int>(std::floor(std::min(ball.x, ball.x + moveX))),
+        static_cast<int>(std::floor(std::min(ball.y, ball.y + moveY))),
+        static_cast<int>(std::ceil(std::fabs(moveX))) + ball.w + 1,
+        static_cast<int>(std::ceil(std::fabs(moveY))) + ball.h + 1};
+
+    float hitTime = 1.0f, normalX = 0, normalY = 0;
+    const SDL_Rect *hitObject = nullptr;
+    grid.query(sweptBounds, [&](int i) {
+      // An object the ball already overlaps is ignored so it can move out
+      float time, nx, ny;
+      if (sweepBall(ball, moveX, moveY, objects[i], time, nx, ny) &&
+          (nx != 0 || ny != 0) && time < hitTime) {
+        hitTime = time;
+        normalX = nx;
+        normalY = ny;
+        hitObject = &objects[i];
+      }
+    });
+
+    // The ball drops as soon as it touches the hole, unless an object is
+    // in the way first
+    float holeTime, holeNormalX, holeNormalY;
+    if (sweepBall(ball, moveX, moveY, holeRect, holeTime, holeNormalX,
+                  holeNormalY) &&
+        (!hitObject || holeTime <= hitTime)) {
+      ball.x = holeRect.x + holeRect.w / 4;
+      ball.y = holeRect.y + holeRect.h / 4;
+
+      ballInHole = true;
+      ball.velX = ball.velY = 0;
+      animationProgress = 0.0f; // Reset animation progress
+      return BALL_ENTERED_HOLE; // Exit the function to start animation
+    }
+
+    ball.x += moveX * hitTime;
+    ball.y += moveY * hitTime;
+    if (!hitObject) {
+      break;
+    }
+
+    reflectBallOffObject(ball, *hitObject, normalX, normalY);
+    bounceCount++; // Increment bounce count on collision
+    event = BALL_BOUNCED;
+    remaining *= 1.0f - hitTime;
+  }
+
+  if (ball.x < bounds.x || ball.x > bounds.x + bounds.w - BALL_SIZE ||
+      ball.y < bounds.y || ball.y > bounds.y + bounds.h - BALL_SIZE) {
+    placeBall(ball, {bounds.x + 3 * bounds.w / 4, bounds.y + 3 * bounds.h / 4,
+                     BALL_SIZE, BALL_SIZE});
+    return BALL_OUT_OF_BOUNDS;
+  }
+
+  return event;
+}
@@ -0,0 +1,69 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include "SpatialGrid.h"
+#include <SDL.h>
+#include <cstddef>
+
+// Window dimensions
+const int SCREEN_WIDTH = 960;
+const int SCREEN_HEIGHT = 540;
+const int BALL_SIZE = 16;
+const int HOLE_SIZE = 16;
+const float BALL_SPEED = 5.0f;
+const float FRICTION = 0.9f;
+const Uint32 MAX_PRESS_DURATION = 400;
+
+// FRICTION, launch speed and the hole animation are tuned per tick of this
+// rate; updateBallPosition scales them to whatever step it is given
+const int REFERENCE_TICK_RATE = 60;
+const int DEFAULT_TICK_RATE = 120;
+// Bounces resolved within a single step before the rest of its motion is
+// dropped; only reachable when wedged between objects
+const int MAX_CONTACTS_PER_STEP = 8;
+
+// Position is kept in sub-pixel floats so slow balls still move at high tick
+// rates, and so rendering can interpolate between ticks
+struct Ball {
+  float x, y;
+  float velX, velY; // pixels per reference tick
+  int w, h;
+
+  SDL_Rect rect() const {
+    return {static_cast<int>(x), static_cast<int>(y), w, h};
+  }
+};
+
+// What happened to the ball during a single updateBallPosition step
+enum BallEvent {
+  BALL_NONE,
+  BALL_BOUNCED,
+  BALL_OUT_OF_BOUNDS,
+  BALL_ENTERED_HOLE,
+  BALL_SETTLED_IN_HOLE
+};
+
+void placeBall(Ball &ball, const SDL_Rect &rect);
+void launchBall(Ball &ball, int targetX, int targetY, Uint32 pressDuration);
+// Swept AABB test of the ball moving by (moveX, moveY) against rect. On a hit,
+// hitTime is the fraction of the move at first contact and the normal points
+// out of the face that was struck; a ball that already overlaps rect reports
+// time 0 and a zero normal.
+bool sweepBall(const Ball &ball, float moveX, float moveY,
+               const SDL_Rect &rect, float &hitTime, float &normalX,
+               float &normalY);
+// Places the ball against the struck face and mirrors its velocity about the
+// contact normal
+void reflectBallOffObject(Ball &ball, const SDL_Rect &objectRect,
+                          float normalX, float normalY);
+// Advances the ball by dt seconds, resolving every contact along the way in
+// time order so fast shots can't pass through objects or the hole. grid must
+// index objects. A ball that leaves bounds is put back three quarters of the
+// way across and down them.
+BallEvent updateBallPosition(Ball &ball, bool moveBall,
+                             const SDL_Rect objects[], const SpatialGrid &grid,
+                             const SDL_Rect &holeRect, const SDL_Rect &bounds,
+                             bool &ballInHole, float &animationProgress,
+                             int &bounceCount, float dt);
+
+#endif
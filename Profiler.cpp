@@ -0,0 +1,233 @@
+#include "Profiler.h"
+#include "TextRenderer.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Frames the overlay's per-phase averages cover
+const int OVERLAY_FRAMES = 120;
+const char PROFILE_CSV_PATH[] = "profile.csv";
+const char PROFILE_TRACE_PATH[] = "profile.json";
+
+Profiler::Slot Profiler::ring[HISTORY_FRAMES];
+std::atomic<Uint64> Profiler::published(0);
+Profiler::Frame Profiler::current;
+std::atomic<Uint64> Profiler::threadTime[PROFILE_PHASE_COUNT];
+bool Profiler::overlayVisible = false;
+
+Uint32 Profiler::micros(Uint64 counterTicks) {
+  static const Uint64 frequency = SDL_GetPerformanceFrequency();
+  return static_cast<Uint32>(counterTicks * 1000000 / frequency);
+}
+
+void Profiler::beginFrame() {
+  current.index = published.load(std::memory_order_relaxed);
+  current.startCounter = SDL_GetPerformanceCounter();
+  current.durationMicros = 0;
+  current.drawCalls = 0;
+  current.textureCreations = 0;
+  current.eventCount = 0;
+}
+
+void Profiler::endFrame() {
+  for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+    Uint64 ticks = threadTime[phase].exchange(0, std::memory_order_relaxed);
+    if (ticks) {
+      record(static_cast<ProfilePhase>(phase), current.startCounter,
+             current.startCounter + ticks);
+    }
+  }
+  current.durationMicros =
+      micros(SDL_GetPerformanceCounter() - current.startCounter);
+
+  // Only the main thread writes, so the slot only needs guarding against
+  // readers
+  Slot &slot = ring[current.index % HISTORY_FRAMES];
+  Uint64 sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.frame = current;
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  published.store(current.index + 1, std::memory_order_release);
+}
+
+void Profiler::record(ProfilePhase phase, Uint64 start, Uint64 end) {
+  if (current.eventCount == MAX_FRAME_EVENTS) {
+    return;
+  }
+  Event &event = current.events[current.eventCount++];
+  event.phase = static_cast<Uint8>(phase);
+  event.startMicros =
+      start > current.startCounter ? micros(start - current.startCounter) : 0;
+  event.durationMicros = micros(end - start);
+}
+
+void Profiler::countDrawCalls(int count) { current.drawCalls += count; }
+
+void Profiler::countTextureCreation() { ++current.textureCreations; }
+
+void Profiler::addThreadTime(ProfilePhase phase, Uint64 counterTicks) {
+  threadTime[phase].fetch_add(counterTicks, std::memory_order_relaxed);
+}
+
+void Profiler::copyFrames(std::vector<Frame> &frames) {
+  frames.clear();
+  Uint64 end = published.load(std::memory_order_acquire);
+  Uint64 begin = end > HISTORY_FRAMES ? end - HISTORY_FRAMES : 0;
+  for (Uint64 index = begin; index < end; ++index) {
+    const Slot &slot = ring[index % HISTORY_FRAMES];
+    Uint64 before = slot.sequence.load(std::memory_order_acquire);
+    Frame frame = slot.frame;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    Uint64 after = slot.sequence.load(std::memory_order_relaxed);
+    // Skip frames overwritten while being copied
+    if (before == after && !(before & 1) && frame.index == index) {
+      frames.push_back(frame);
+    }
+  }
+}
+
+bool Profiler::handleKey(SDL_Keycode key) {
+  if (key == SDLK_F3) {
+    overlayVisible = !overlayVisible;
+  } else if (key == SDLK_F4) {
+    writeCsv(PROFILE_CSV_PATH);
+  } else if (key == SDLK_F5) {
+    writeTrace(PROFILE_TRACE_PATH);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *Profiler::phaseName(ProfilePhase phase) {
+  static const char *names[PROFILE_PHASE_COUNT] = {
+      "events",         "preview",   "physics",    "render background",
+      "render sprites", "particles", "render hud", "present",
+      "sleep"};
+  return names[phase];
+}
+
+void Profiler::drawOverlay() {
+  if (!overlayVisible) {
+    return;
+  }
+
+  std::vector<Frame> frames;
+  copyFrames(frames);
+  if (frames.empty()) {
+    return;
+  }
+
+  std::vector<Uint32> durations;
+  for (const Frame &frame : frames) {
+    durations.push_back(frame.durationMicros);
+  }
+  std::sort(durations.begin(), durations.end());
+  auto percentile = [&](int p) {
+    return durations[(durations.size() - 1) * p / 100] / 1000.0;
+  };
+
+  // Average time per frame in each phase over the most recent frames
+  double phaseMicros[PROFILE_PHASE_COUNT] = {};
+  size_t recent = std::min<size_t>(frames.size(), OVERLAY_FRAMES);
+  for (size_t i = frames.size() - recent; i < frames.size(); ++i) {
+    for (int e = 0; e < frames[i].eventCount; ++e) {
+      const Event &event = frames[i].events[e];
+      phaseMicros[event.phase] += event.durationMicros;
+    }
+  }
+
+  const SDL_Color color = {255, 255, 0, 255};
+  const Frame &last = frames.back();
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(2) << "frame p50 " << percentile(50)
+       << " p95 " << percentile(95) << " p99 " << percentile(99) << " ms";
+  int y = 10;
+  TextRenderer::drawText("font", line.str(), 600, y, color);
+  for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+    line.str("");
+    line << phaseName(static_cast<ProfilePhase>(phase)) << " "
+         << phaseMicros[phase] / recent / 1000.0 << " ms";
+    TextRenderer::drawText("font", line.str(), 600, y += 24, color);
+  }
+  line.str("");
+  line << "draws " << last.drawCalls << " textures " << last.textureCreations;
+  TextRenderer::drawText("font", line.str(), 600, y += 24, color);
+}
+
+bool Profiler::writeCsv(const std::string &path) {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Unable to write profile " << path << std::endl;
+    return false;
+  }
+
+  std::vector<Frame> frames;
+  copyFrames(frames);
+  file << "frame,frame_ms";
+  for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+    std::string column = phaseName(static_cast<ProfilePhase>(phase));
+    std::replace(column.begin(), column.end(), ' ', '_');
+    file << "," << column << "_ms";
+  }
+  file << ",draw_calls,texture_creations\n";
+
+  for (const Frame &frame : frames) {
+    double phaseMicros[PROFILE_PHASE_COUNT] = {};
+    for (int e = 0; e < frame.eventCount; ++e) {
+      phaseMicros[frame.events[e].phase] += frame.events[e].durationMicros;
+    }
+    file << frame.index << "," << frame.durationMicros / 1000.0;
+    for (double micros : phaseMicros) {
+      file << "," << micros / 1000.0;
+    }
+    file << "," << frame.drawCalls << "," << frame.textureCreations << "\n";
+  }
+  std::cout << "Wrote " << frames.size() << " frames to " << path
+            << std::endl;
+  return true;
+}
+
+bool Profiler::writeTrace(const std::string &path) {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Unable to write trace " << path << std::endl;
+    return false;
+  }
+
+  std::vector<Frame> frames;
+  copyFrames(frames);
+  const Uint64 origin = frames.empty() ? 0 : frames.front().startCounter;
+
+  // Trace event format: complete ("X") events for the frame and its phases,
+  // and counter ("C") events for the per-frame counts, all in microseconds
+  file << "{\"traceEvents\":[";
+  const char *separator = "\n";
+  for (const Frame &frame : frames) {
+    Uint32 frameStart = micros(frame.startCounter - origin);
+    file << separator << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,"
+         << "\"tid\":1,\"ts\":" << frameStart
+         << ",\"dur\":" << frame.durationMicros << ",\"args\":{\"index\":"
+         << frame.index << "}}";
+    separator = ",\n";
+    for (int e = 0; e < frame.eventCount; ++e) {
+      const Event &event = frame.events[e];
+      file << separator << "{\"name\":\""
+           << phaseName(static_cast<ProfilePhase>(event.phase))
+           << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+           << frameStart + event.startMicros
+           << ",\"dur\":" << event.durationMicros << "}";
+    }
+    file << separator << "{\"name\":\"counts\",\"ph\":\"C\",\"pid\":1,"
+         << "\"ts\":" << frameStart << ",\"args\":{\"draw calls\":"
+         << frame.drawCalls
+         << ",\"texture creations\":" << frame.textureCreations << "}}";
+  }
+  file << "\n]}\n";
+  std::cout << "Wrote " << frames.size() << " frames to " << path
+            << std::endl;
+  return true;
+}
@@ -0,0 +1,102 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SDL.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Phases of the main loop that get their own timers
+enum ProfilePhase {
+  PROFILE_EVENTS,
+  PROFILE_PREVIEW,
+  PROFILE_PHYSICS,
+  PROFILE_RENDER_BACKGROUND,
+  PROFILE_RENDER_SPRITES,
+  PROFILE_PARTICLES,
+  PROFILE_RENDER_HUD,
+  PROFILE_PRESENT,
+  PROFILE_SLEEP,
+  PROFILE_PHASE_COUNT
+};
+
+// Frame profiler. The main loop brackets each frame with beginFrame() and
+// endFrame() and each phase with a ProfileScope; draw calls and texture
+// creations are counted by the code that makes them. Finished frames go
+// into a fixed ring that any thread can read without locking the writer.
+// F3 toggles an overlay with frame-time percentiles, F4 writes the history
+// as CSV and F5 as a Chrome trace (chrome://tracing, Perfetto).
+class Profiler {
+public:
+  static const int HISTORY_FRAMES = 512;
+  static const int MAX_FRAME_EVENTS = 64;
+
+  struct Event {
+    Uint8 phase;
+    Uint32 startMicros; // From the start of the frame
+    Uint32 durationMicros;
+  };
+  struct Frame {
+    Uint64 index;
+    Uint64 startCounter; // SDL performance counter
+    Uint32 durationMicros;
+    int drawCalls;
+    int textureCreations;
+    int eventCount;
+    Event events[MAX_FRAME_EVENTS];
+  };
+
+  static void beginFrame();
+  static void endFrame();
+  static void countDrawCalls(int count = 1);
+  static void countTextureCreation();
+  // Time another thread spent on phase, in performance counter ticks. It is
+  // reported as one event at the start of the next frame to end.
+  static void addThreadTime(ProfilePhase phase, Uint64 counterTicks);
+
+  // Finished frames still in the ring, oldest first
+  static void copyFrames(std::vector<Frame> &frames);
+
+  // Handles the profiler's keys; returns false for any other key
+  static bool handleKey(SDL_Keycode key);
+  static void drawOverlay();
+  static bool writeCsv(const std::string &path);
+  static bool writeTrace(const std::string &path);
+
+  static const char *phaseName(ProfilePhase phase);
+
+private:
+  friend class ProfileScope;
+
+  // A slot's sequence is odd while the writer is filling it, so a reader
+  // that sees it change or odd knows its copy is torn
+  struct Slot {
+    std::atomic<Uint64> sequence;
+    Frame frame;
+  };
+
+  static void record(ProfilePhase phase, Uint64 start, Uint64 end);
+  static Uint32 micros(Uint64 counterTicks);
+
+  static Slot ring[HISTORY_FRAMES];
+  static std::atomic<Uint64> published;
+  static Frame current;
+  static std::atomic<Uint64> threadTime[PROFILE_PHASE_COUNT];
+  static bool overlayVisible;
+};
+
+// Times the enclosing block as one event of phase in the current frame
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfilePhase phase)
+      : phase(phase), start(SDL_GetPerformanceCounter()) {}
+  ~ProfileScope() {
+    Profiler::record(phase, start, SDL_GetPerformanceCounter());
+  }
+
+private:
+  ProfilePhase phase;
+  Uint64 start;
+};
+
+#endif
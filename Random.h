@@ -0,0 +1,31 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Small seeded generator (SplitMix64). Unlike rand() it gives the same
+// sequence on every platform, so a seed fully describes what it generates.
+class Random {
+public:
+  explicit Random(uint64_t seed) : state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform integer in [0, bound)
+  uint32_t below(uint32_t bound) {
+    return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+  }
+
+  // Uniform float in [0, 1)
+  float unit() { return (next() >> 40) * (1.0f / 16777216.0f); }
+
+private:
+  uint64_t state;
+};
+
+#endif
@@ -0,0 +1,331 @@
+#include "Render.h"
+#include "Profiler.h"
+#include "TextRenderer.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The background, obstacles and hole of one screen-sized chunk of the
+// course, composited into a render target. Chunks are built when they first
+// come into view and kept until the layout changes or the budget needs room.
+struct StaticChunk {
+  SDL_Texture *texture;
+  int column, row;
+  bool valid;
+  Uint64 lastUsed; // Frame the chunk was last drawn in
+};
+static std::vector<StaticChunk> staticChunks;
+static Uint64 staticFrame = 0;
+// Set when the renderer can't provide a target, so render() stops trying
+// and draws the static scene itself every frame
+static bool staticLayerUnavailable = false;
+
+void invalidateStaticLayer() {
+  for (StaticChunk &chunk : staticChunks) {
+    chunk.valid = false;
+  }
+}
+
+void freeStaticLayer() {
+  for (StaticChunk &chunk : staticChunks) {
+    SDL_DestroyTexture(chunk.texture);
+  }
+  staticChunks.clear();
+  staticLayerUnavailable = false;
+}
+
+static SDL_Rect offsetRect(const SDL_Rect &rect, int originX, int originY) {
+  return {rect.x - originX, rect.y - originY, rect.w, rect.h};
+}
+
+// Draws the part of the course in area, which stays put for the length of a
+// level, with area's top-left corner at (targetX, targetY) on the target
+static void drawStaticScene(SDL_Renderer *renderer, SpriteBatch &batch,
+                            SDL_Texture *backgroundTexture,
+                            const Sprite *objectSprites[],
+                            const Sprite *holeSprite,
+                            const SDL_Rect objects[], const SpatialGrid &grid,
+                            const SDL_Rect &holeRect, size_t numObjectSprites,
+                            const SDL_Rect &area, int targetX, int targetY) {
+  const int originX = area.x - targetX, originY = area.y - targetY;
+  if (backgroundTexture) {
+    // The background is one screen, so every chunk shows it whole
+    SDL_Rect backgroundRect = {targetX, targetY, area.w, area.h};
+    SDL_RenderCopy(renderer, backgroundTexture, nullptr, &backgroundRect);
+    Profiler::countDrawCalls();
+  }
+
+  // Sprites come from the shared atlas, so the objects and the hole go out
+  // as one geometry submission
+  batch.begin(renderer);
+
+  // Only objects that reach the area are drawn; the tile sprites are reused
+  // round-robin once a course has more objects than sprites
+  grid.query(area, [&](int i) {
+    const Sprite *objectSprite = objectSprites[i % numObjectSprites];
+    if (objectSprite && SDL_HasIntersection(&objects[i], &area)) {
+      batch.draw(*objectSprite, offsetRect(objects[i], originX, originY));
+    }
+  });
+  if (holeSprite && SDL_HasIntersection(&holeRect, &area)) {
+    batch.draw(*holeSprite, offsetRect(holeRect, originX, originY));
+  }
+  batch.flush();
+}
+
+static StaticChunk *findStaticChunk(int column, int row) {
+  for (StaticChunk &chunk : staticChunks) {
+    if (chunk.column == column && chunk.row == row) {
+      return &chunk;
+    }
+  }
+  return nullptr;
+}
+
+static SDL_Rect chunkArea(int column, int row) {
+  return {column * SCREEN_WIDTH, row * SCREEN_HEIGHT, SCREEN_WIDTH,
+          SCREEN_HEIGHT};
+}
+
+// Returns the chunk at (column, row), composited and ready to draw, or null
+// if the renderer has no render target to give. Makes room by reusing the
+// least recently drawn chunk once the budget is spent, never one needed this
+// frame.
+static StaticChunk *buildStaticChunk(SDL_Renderer *renderer,
+                                     SpriteBatch &batch,
+                                     SDL_Texture *backgroundTexture,
+                                     const Sprite *objectSprites[],
+                                     const Sprite *holeSprite,
+                                     const SDL_Rect objects[],
+                                     const SpatialGrid &grid,
+                                     const SDL_Rect &holeRect,
+                                     size_t numObjectSprites, int column,
+                                     int row) {
+  StaticChunk *chunk = findStaticChunk(column, row);
+  if (chunk && chunk->valid) {
+    return chunk;
+  }
+
+  if (!chunk) {
+    const size_t chunkBytes =
+        static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT * 4;
+    const size_t maxChunks = std::max<size_t>(
+        MIN_STATIC_CHUNKS, STATIC_LAYER_BUDGET_BYTES / chunkBytes);
+    if (staticChunks.size() >= maxChunks) {
+      // Chunks left over from an earlier layout go first
+      auto lastDrawn = [](const StaticChunk &chunk) {
+        return chunk.valid ? chunk.lastUsed : 0;
+      };
+      for (StaticChunk &candidate : staticChunks) {
+        if (candidate.lastUsed != staticFrame &&
+            (!chunk || lastDrawn(candidate) < lastDrawn(*chunk))) {
+          chunk = &candidate;
+        }
+      }
+    }
+    if (!chunk) {
+      SDL_Texture *texture = nullptr;
+      if (SDL_RenderTargetSupported(renderer)) {
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH,
+                                    SCREEN_HEIGHT);
+      }
+      if (!texture) {
+        std::cerr << "No render target for the static layer, drawing the "
+                     "course every frame: "
+                  << SDL_GetError() << std::endl;
+        freeStaticLayer();
+        staticLayerUnavailable = true;
+        return nullptr;
+      }
+      Profiler::countTextureCreation();
+      // A chunk covers its whole screen, so there's nothing to blend with
+      SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+      staticChunks.push_back({texture, 0, 0, false, 0});
+      chunk = &staticChunks.back();
+    }
+    chunk->column = column;
+    chunk->row = row;
+  }
+
+  if (SDL_SetRenderTarget(renderer, chunk->texture) != 0) {
+    std::cerr << "Unable to draw to the static layer: " << SDL_GetError()
+              << std::endl;
+    freeStaticLayer();
+    staticLayerUnavailable = true;
+    return nullptr;
+  }
+  SDL_RenderClear(renderer);
+  drawStaticScene(renderer, batch, backgroundTexture, objectSprites,
+                  holeSprite, objects, grid, holeRect, numObjectSprites,
+                  chunkArea(column, row), 0, 0);
+  SDL_SetRenderTarget(renderer, nullptr);
+  chunk->valid = true;
+  return chunk;
+}
+
+// Floor division, so chunks left of or above the origin are numbered right
+static int chunkOf(int coordinate, int chunkSize) {
+  return coordinate >= 0 ? coordinate / chunkSize
+                         : (coordinate - chunkSize + 1) / chunkSize;
+}
+
+void render(SDL_Renderer *renderer, SpriteBatch &batch,
+            SDL_Texture *startScreenTexture, SDL_Texture *backgroundTexture,
+            const Sprite *ballSprite, const Sprite *arrowSprite,
+            const Sprite *objectSprites[], const Sprite *holeSprite,
+            const SDL_Rect &ballRect, const SDL_Rect &arrowRect,
+            const SDL_Rect objects[], const SpatialGrid &grid,
+            const SDL_Rect &holeRect, const SDL_Rect &camera,
+            ParticleSystem &particles, const TrajectoryPreview &preview,
+            bool showArrow, float arrowAngle, GameState currentState,
+            size_t numObjectSprites, SDL_Texture *flashScreenTexture,
+            int bounces, int par, int hintPower, float fade) {
+  if (currentState == START_SCREEN) {
+    ProfileScope scope(PROFILE_RENDER_BACKGROUND);
+    SDL_RenderClear(renderer);
+    if (startScreenTexture) {
+      SDL_RenderCopy(renderer, startScreenTexture, nullptr, nullptr);
+      Profiler::countDrawCalls();
+    } else {
+      std::cerr << "Failed to load start screen texture." << std::endl;
+    }
+  } else if (currentState == GAME_RUNNING ||
+             currentState == GAME_HOLED_OUT) {
+    {
+      ProfileScope scope(PROFILE_RENDER_BACKGROUND);
+      // Nothing in the static layer moves during a level, so each chunk is
+      // only composited when it comes into view or the layout changes, and
+      // the at most four the camera overlaps are copied whole every frame
+      const int firstColumn = chunkOf(camera.x, SCREEN_WIDTH);
+      const int firstRow = chunkOf(camera.y, SCREEN_HEIGHT);
+      const int lastColumn = chunkOf(camera.x + camera.w - 1, SCREEN_WIDTH);
+      const int lastRow = chunkOf(camera.y + camera.h - 1, SCREEN_HEIGHT);
+      ++staticFrame;
+      // Chunks are all built before anything is drawn to the screen, since
+      // switching targets mid-frame isn't safe on every backend
+      for (int row = firstRow; row <= lastRow && !staticLayerUnavailable;
+           ++row) {
+        for (int column = firstColumn;
+             column <= lastColumn && !staticLayerUnavailable; ++column) {
+          StaticChunk *chunk = buildStaticChunk(
+              renderer, batch, backgroundTexture, objectSprites, holeSprite,
+              objects, grid, holeRect, numObjectSprites, column, row);
+          if (chunk) {
+            chunk->lastUsed = staticFrame;
+          }
+        }
+      }
+
+      SDL_RenderClear(renderer);
+      for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+          SDL_Rect area = chunkArea(column, row);
+          SDL_Rect onScreen = offsetRect(area, camera.x, camera.y);
+          const StaticChunk *chunk = findStaticChunk(column, row);
+          if (chunk && chunk->valid) {
+            SDL_RenderCopy(renderer, chunk->texture, nullptr, &onScreen);
+            Profiler::countDrawCalls();
+            continue;
+          }
+          // Drawn straight to the screen, clipped so objects on a chunk
+          // border aren't drawn twice
+          SDL_Rect screenRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+          SDL_Rect clip;
+          SDL_IntersectRect(&onScreen, &screenRect, &clip);
+          SDL_RenderSetClipRect(renderer, &clip);
+          drawStaticScene(renderer, batch, backgroundTexture, objectSprites,
+                          holeSprite, objects, grid, holeRect,
+                          numObjectSprites, area, onScreen.x, onScreen.y);
+          SDL_RenderSetClipRect(renderer, nullptr);
+        }
+      }
+    }
+
+    {
+      ProfileScope scope(PROFILE_PARTICLES);
+      particles.draw(renderer, camera);
+    }
+
+    {
+      ProfileScope scope(PROFILE_RENDER_SPRITES);
+      batch.begin(renderer);
+      if (ballSprite) {
+        // Same atlas as the ball and arrow, so still one draw call
+        preview.draw(batch, *ballSprite, camera);
+        batch.draw(*ballSprite, offsetRect(ballRect, camera.x, camera.y));
+      }
+      if (showArrow && arrowSprite) {
+        batch.draw(*arrowSprite, offsetRect(arrowRect, camera.x, camera.y),
+                   arrowAngle);
+      }
+      batch.flush();
+    }
+
+    ProfileScope scope(PROFILE_RENDER_HUD);
+    // Render the bounce count; the texture is only rebuilt when it changes
+    SDL_Color textColor = {255, 255, 255, 255}; // White color
+    TextRenderer::drawCachedText(
+        "font", "Bounce #" + std::to_string(bounces), 40, 30, textColor);
+    if (par) {
+      TextRenderer::drawCachedText("font", "Par " + std::to_string(par), 40,
+                                   60, textColor);
+    }
+    if (hintPower) {
+      TextRenderer::drawCachedText(
+          "font", "Hint: " + std::to_string(hintPower) + "% power", 40, 90,
+          textColor);
+    }
+
+    if (currentState == GAME_HOLED_OUT && flashScreenTexture) {
+      // Blend the level-complete screen in over the course, leaving the
+      // texture as it was for when it's drawn on its own
+      SDL_BlendMode blendMode;
+      SDL_GetTextureBlendMode(flashScreenTexture, &blendMode);
+      SDL_SetTextureBlendMode(flashScreenTexture, SDL_BLENDMODE_BLEND);
+      SDL_SetTextureAlphaMod(flashScreenTexture,
+                             static_cast<Uint8>(fade * 255.0f));
+      SDL_RenderCopy(renderer, flashScreenTexture, nullptr, nullptr);
+      Profiler::countDrawCalls();
+      SDL_SetTextureAlphaMod(flashScreenTexture, 255);
+      SDL_SetTextureBlendMode(flashScreenTexture, blendMode);
+    }
+  } else if (currentState == GAME_COMPLETED) {
+    ProfileScope scope(PROFILE_RENDER_BACKGROUND);
+    SDL_RenderClear(renderer);
+    if (flashScreenTexture) {
+      SDL_RenderCopy(renderer, flashScreenTexture, nullptr, nullptr);
+      Profiler::countDrawCalls();
+    } else {
+      std::cerr << "Failed to load flash screen texture." << std::endl;
+    }
+  }
+
+  {
+    ProfileScope scope(PROFILE_RENDER_HUD);
+    Profiler::drawOverlay();
+  }
+
+  ProfileScope scope(PROFILE_PRESENT);
+  SDL_RenderPresent(renderer);
+}
+
+SDL_Rect interpolateBallRect(const Ball &previous, const Ball &current,
+                             float alpha) {
+  float x = previous.x + (current.x - previous.x) * alpha;
+  float y = previous.y + (current.y - previous.y) * alpha;
+  return {static_cast<int>(x), static_cast<int>(y), current.w, current.h};
+}
+
+SDL_Rect followCamera(const SDL_Rect &ballRect, const SDL_Rect &bounds) {
+  // Centred on the ball, then pushed back inside the course; a course
+  // smaller than the screen sits at its top-left corner
+  auto axis = [](int ball, int ballSize, int start, int size, int view) {
+    int position = ball + ballSize / 2 - view / 2;
+    return std::max(start, std::min(position, start + size - view));
+  };
+  return {axis(ballRect.x, ballRect.w, bounds.x, bounds.w, SCREEN_WIDTH),
+          axis(ballRect.y, ballRect.h, bounds.y, bounds.h, SCREEN_HEIGHT),
+          SCREEN_WIDTH, SCREEN_HEIGHT};
+}
@@ -0,0 +1,61 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "ParticleSystem.h"
+#include "Physics.h"
+#include "SpatialGrid.h"
+#include "SpriteBatch.h"
+#include "TextureManager.h"
+#include "TrajectoryPreview.h"
+#include <SDL.h>
+#include <cstddef>
+
+// Game states. GAME_HOLED_OUT is the fade from the course to the
+// level-complete screen once the ball drops.
+enum GameState {
+  START_SCREEN,
+  GAME_RUNNING,
+  GAME_HOLED_OUT,
+  GAME_COMPLETED,
+  GAME_EXIT
+};
+
+// Most memory the cached static layer may take; it never holds fewer chunks
+// than the four a screen-sized view can overlap
+const size_t STATIC_LAYER_BUDGET_BYTES = 32 * 1024 * 1024;
+const size_t MIN_STATIC_CHUNKS = 4;
+
+// Draws and presents one frame of currentState to renderer. Sprites go
+// through batch; grid must index objects. Rects are in course coordinates
+// and camera is the part of the course on screen. Particles are drawn under
+// the ball, and so is the preview, in dots of the ball sprite. fade is how
+// far the level-complete screen has faded in over the course in
+// GAME_HOLED_OUT, from 0 to 1.
+void render(SDL_Renderer *renderer, SpriteBatch &batch,
+            SDL_Texture *startScreenTexture, SDL_Texture *backgroundTexture,
+            const Sprite *ballSprite, const Sprite *arrowSprite,
+            const Sprite *objectSprites[], const Sprite *holeSprite,
+            const SDL_Rect &ballRect, const SDL_Rect &arrowRect,
+            const SDL_Rect objects[], const SpatialGrid &grid,
+            const SDL_Rect &holeRect, const SDL_Rect &camera,
+            ParticleSystem &particles, const TrajectoryPreview &preview,
+            bool showArrow, float arrowAngle, GameState currentState,
+            size_t numObjectSprites, SDL_Texture *flashScreenTexture,
+            int bounces, int par, int hintPower, float fade);
+
+// render() keeps the background, obstacles and hole of a running level in a
+// cached layer of screen-sized chunks, built as they come into view and
+// evicted least recently drawn first once STATIC_LAYER_BUDGET_BYTES is
+// spent. Invalidate it whenever the layout changes or the renderer resets
+// its render targets, and free it before destroying the renderer.
+void invalidateStaticLayer();
+void freeStaticLayer();
+
+// Screen-sized view of bounds that follows the ball
+SDL_Rect followCamera(const SDL_Rect &ballRect, const SDL_Rect &bounds);
+
+// Ball rect to draw alpha of the way from the previous tick to the current one
+SDL_Rect interpolateBallRect(const Ball &previous, const Ball &current,
+                             float alpha);
+
+#endif
@@ -0,0 +1,168 @@
+#include "Replay.h"
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+static uint64_t zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool ReplayWriter::open(const std::string &path, int tickRate,
+                        CourseSize courseSize) {
+  file.open(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cerr << "Unable to record replay " << path << std::endl;
+    return false;
+  }
+  file.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+  file.put(static_cast<char>(REPLAY_VERSION));
+  writeVarint(static_cast<uint64_t>(tickRate));
+  writeVarint(static_cast<uint64_t>(courseSize.columns));
+  writeVarint(static_cast<uint64_t>(courseSize.rows));
+  lastTick = 0;
+  file.flush();
+  return true;
+}
+
+void ReplayWriter::level(uint64_t tick, uint64_t seed) {
+  if (!isOpen()) {
+    return;
+  }
+  begin(REPLAY_LEVEL, tick);
+  writeVarint(seed);
+  file.flush();
+}
+
+void ReplayWriter::shot(uint64_t tick, int targetX, int targetY,
+                        Uint32 pressDuration) {
+  if (!isOpen()) {
+    return;
+  }
+  begin(REPLAY_SHOT, tick);
+  writeVarint(zigzag(targetX));
+  writeVarint(zigzag(targetY));
+  writeVarint(pressDuration);
+  file.flush();
+}
+
+void ReplayWriter::rewind(uint64_t tick, uint64_t rewindTicks) {
+  if (!isOpen()) {
+    return;
+  }
+  begin(REPLAY_REWIND, tick);
+  writeVarint(rewindTicks);
+  file.flush();
+}
+
+void ReplayWriter::undo(uint64_t tick) {
+  if (!isOpen()) {
+    return;
+  }
+  begin(REPLAY_UNDO, tick);
+  file.flush();
+}
+
+void ReplayWriter::begin(ReplayRecordType type, uint64_t tick) {
+  file.put(static_cast<char>(type));
+  writeVarint(tick - lastTick);
+  lastTick = tick;
+}
+
+void ReplayWriter::writeVarint(uint64_t value) {
+  while (value >= 0x80) {
+    file.put(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  file.put(static_cast<char>(value));
+}
+
+bool loadReplay(const std::string &path, Replay &replay) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Unable to open replay " << path << std::endl;
+    return false;
+  }
+  std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+
+  size_t offset = 0;
+  bool truncated = false;
+  auto readVarint = [&]() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (offset >= bytes.size()) {
+        truncated = true;
+        return value;
+      }
+      unsigned char byte = bytes[offset++];
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    truncated = true;
+    return value;
+  };
+
+  // Version 1 predates scrolling courses and version 2 rewinding; both are
+  // otherwise the same
+  if (bytes.size() < sizeof(REPLAY_MAGIC) + 1 ||
+      std::memcmp(bytes.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0 ||
+      bytes[sizeof(REPLAY_MAGIC)] < 1 ||
+      bytes[sizeof(REPLAY_MAGIC)] > REPLAY_VERSION) {
+    std::cerr << path << ": not a version 1-" << int(REPLAY_VERSION)
+              << " replay" << std::endl;
+    return false;
+  }
+  Uint8 version = bytes[sizeof(REPLAY_MAGIC)];
+  offset = sizeof(REPLAY_MAGIC) + 1;
+  replay.tickRate = static_cast<int>(readVarint());
+  replay.courseSize = SINGLE_SCREEN;
+  if (version >= 2) {
+    replay.courseSize.columns = static_cast<int>(readVarint());
+    replay.courseSize.rows = static_cast<int>(readVarint());
+  }
+  replay.records.clear();
+
+  uint64_t tick = 0;
+  while (offset < bytes.size()) {
+    ReplayRecord record = {};
+    record.type = static_cast<ReplayRecordType>(bytes[offset++]);
+    tick += readVarint();
+    record.tick = tick;
+    if (record.type == REPLAY_LEVEL) {
+      record.seed = readVarint();
+    } else if (record.type == REPLAY_SHOT) {
+      record.targetX = static_cast<int>(unzigzag(readVarint()));
+      record.targetY = static_cast<int>(unzigzag(readVarint()));
+      record.pressDuration = static_cast<Uint32>(readVarint());
+    } else if (record.type == REPLAY_REWIND && version >= 3) {
+      record.rewindTicks = readVarint();
+    } else if (record.type != REPLAY_UNDO || version < 3) {
+      std::cerr << path << ": bad record type " << int(record.type)
+                << std::endl;
+      return false;
+    }
+    // A session cut short mid-record still replays up to that point
+    if (truncated) {
+      std::cerr << path << ": truncated record ignored" << std::endl;
+      break;
+    }
+    replay.records.push_back(record);
+  }
+
+  if (replay.tickRate < 1) {
+    std::cerr << path << ": bad tick rate" << std::endl;
+    return false;
+  }
+  if (replay.courseSize.columns < 1 || replay.courseSize.rows < 1) {
+    std::cerr << path << ": bad course size" << std::endl;
+    return false;
+  }
+  return true;
+}
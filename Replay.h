@@ -0,0 +1,68 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "Level.h"
+#include <SDL.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Session recording: the levels played and every stroke, stamped with the
+// physics tick it happened before. Physics is deterministic at a given tick
+// rate, so this is enough to reproduce a session exactly.
+//
+// Layout: magic, version byte, tick rate, the generated courses' size in
+// screens across and down, then one record after another.
+// A record is a type byte, the ticks since the previous record, and its
+// fields. Every number is a LEB128 varint, zigzag-encoded where it can be
+// negative, so a stroke usually takes 7 bytes.
+const char REPLAY_MAGIC[4] = {'G', 'R', 'E', 'P'};
+const Uint8 REPLAY_VERSION = 3;
+const char DEFAULT_REPLAY_PATH[] = "session.replay";
+
+enum ReplayRecordType {
+  REPLAY_LEVEL = 1, // Level seed; 0 is the built-in course
+  REPLAY_SHOT = 2,  // Mouse position at release and press duration
+  REPLAY_REWIND = 3, // Ticks to go back
+  REPLAY_UNDO = 4    // Takes back the last stroke; no fields
+};
+
+struct ReplayRecord {
+  ReplayRecordType type;
+  uint64_t tick; // Physics ticks run before this record applies
+  uint64_t seed;
+  int targetX, targetY;
+  Uint32 pressDuration;
+  uint64_t rewindTicks;
+};
+
+struct Replay {
+  int tickRate;
+  CourseSize courseSize; // Single screen in version 1 replays
+  std::vector<ReplayRecord> records;
+};
+
+// Appends records to a replay file as they happen, flushing each one so a
+// crash still leaves a usable log
+class ReplayWriter {
+public:
+  bool open(const std::string &path, int tickRate, CourseSize courseSize);
+  bool isOpen() const { return file.is_open(); }
+
+  void level(uint64_t tick, uint64_t seed);
+  void shot(uint64_t tick, int targetX, int targetY, Uint32 pressDuration);
+  void rewind(uint64_t tick, uint64_t rewindTicks);
+  void undo(uint64_t tick);
+
+private:
+  void begin(ReplayRecordType type, uint64_t tick);
+  void writeVarint(uint64_t value);
+
+  std::ofstream file;
+  uint64_t lastTick = 0;
+};
+
+bool loadReplay(const std::string &path, Replay &replay);
+
+#endif
@@ -0,0 +1,220 @@
+#include "Rewind.h"
+#include <algorithm>
+#include <cstring>
+
+// Which fields a delta carries. ballInHole is stored as the bit itself;
+// DELTA_SIZE carries the ball's width then height, which shrink as it drops
+// into the hole.
+enum DeltaField {
+  DELTA_X = 1 << 0,
+  DELTA_Y = 1 << 1,
+  DELTA_VEL_X = 1 << 2,
+  DELTA_VEL_Y = 1 << 3,
+  DELTA_ANIMATION = 1 << 4,
+  DELTA_BOUNCES = 1 << 5,
+  DELTA_IN_HOLE = 1 << 6,
+  DELTA_SIZE = 1 << 7
+};
+
+// Mask byte, five floats of up to five bytes, the bounce change and the
+// two sizes
+const size_t MAX_DELTA_BYTES = 1 + 5 * 5 + 5 + 2 * 5;
+
+static_assert(REWIND_KEYFRAME_TICKS * MAX_DELTA_BYTES < REWIND_BUFFER_BYTES,
+              "The newest keyframe's deltas must always fit");
+
+static uint32_t floatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static size_t putVarint(Uint8 *out, uint32_t value) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = static_cast<Uint8>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out[length++] = static_cast<Uint8>(value);
+  return length;
+}
+
+static bool sameState(const RewindState &a, const RewindState &b) {
+  return a.ball.x == b.ball.x && a.ball.y == b.ball.y &&
+         a.ball.velX == b.ball.velX && a.ball.velY == b.ball.velY &&
+         a.ball.w == b.ball.w && a.ball.h == b.ball.h &&
+         a.animationProgress == b.animationProgress &&
+         a.bounces == b.bounces && a.ballInHole == b.ballInHole;
+}
+
+// Writes the fields of state that differ from previous to out and returns
+// the length
+static size_t encodeDelta(const RewindState &previous,
+                          const RewindState &state, Uint8 *out) {
+  const float before[5] = {previous.ball.x, previous.ball.y,
+                           previous.ball.velX, previous.ball.velY,
+                           previous.animationProgress};
+  const float after[5] = {state.ball.x, state.ball.y, state.ball.velX,
+                          state.ball.velY, state.animationProgress};
+
+  Uint8 mask = state.ballInHole ? DELTA_IN_HOLE : 0;
+  size_t length = 1;
+  for (int i = 0; i < 5; ++i) {
+    // Nearby floats share their high bits, so the XOR is a short varint
+    uint32_t change = floatBits(before[i]) ^ floatBits(after[i]);
+    if (change != 0) {
+      mask |= 1 << i;
+      length += putVarint(out + length, change);
+    }
+  }
+  if (state.bounces != previous.bounces) {
+    mask |= DELTA_BOUNCES;
+    length += putVarint(
+        out + length, static_cast<uint32_t>(state.bounces - previous.bounces));
+  }
+  if (state.ball.w != previous.ball.w || state.ball.h != previous.ball.h) {
+    mask |= DELTA_SIZE;
+    length += putVarint(out + length, static_cast<uint32_t>(state.ball.w ^
+                                                            previous.ball.w));
+    length += putVarint(out + length, static_cast<uint32_t>(state.ball.h ^
+                                                            previous.ball.h));
+  }
+  out[0] = mask;
+  return length;
+}
+
+RewindBuffer::RewindBuffer()
+    : bytes(REWIND_BUFFER_BYTES), written(0), keyframes(REWIND_MAX_KEYFRAMES),
+      oldestKeyframe(0), newestKeyframe(0), newest(0), last(),
+      strokeRing(REWIND_MAX_STROKES), strokeStart(0), strokeCount(0) {}
+
+void RewindBuffer::reset(const RewindState &state) {
+  strokeStart = strokeCount = 0;
+  restart(0, state);
+}
+
+void RewindBuffer::restart(uint64_t tick, const RewindState &state) {
+  oldestKeyframe = newestKeyframe = tick / REWIND_KEYFRAME_TICKS;
+  keyframe(newestKeyframe) = {state, tick, written};
+  newest = tick;
+  last = state;
+}
+
+void RewindBuffer::record(const RewindState &state) {
+  if (sameState(state, last)) {
+    return;
+  }
+  ++newest;
+  if (newest % REWIND_KEYFRAME_TICKS == 0) {
+    newestKeyframe = newest / REWIND_KEYFRAME_TICKS;
+    if (newestKeyframe - oldestKeyframe == REWIND_MAX_KEYFRAMES) {
+      ++oldestKeyframe;
+    }
+    keyframe(newestKeyframe) = {state, newest, written};
+    last = state;
+    return;
+  }
+
+  Uint8 delta[MAX_DELTA_BYTES];
+  size_t length = encodeDelta(last, state, delta);
+  // Forget the keyframes whose deltas this would write over
+  while (oldestKeyframe < newestKeyframe &&
+         written + length > keyframe(oldestKeyframe).offset + bytes.size()) {
+    ++oldestKeyframe;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    bytes[(written + i) % bytes.size()] = delta[i];
+  }
+  written += length;
+  last = state;
+}
+
+void RewindBuffer::markStroke() {
+  if (strokeCount == strokeRing.size()) {
+    strokeStart = (strokeStart + 1) % strokeRing.size();
+    --strokeCount;
+  }
+  size_t slot = (strokeStart + strokeCount++) % strokeRing.size();
+  strokeRing[slot] = {last, newest};
+}
+
+uint64_t RewindBuffer::oldestTick() const {
+  return keyframe(oldestKeyframe).tick;
+}
+
+size_t RewindBuffer::memoryBytes() const {
+  return sizeof(*this) + bytes.size() + keyframes.size() * sizeof(Keyframe) +
+         strokeRing.size() * sizeof(Stroke);
+}
+
+RewindState RewindBuffer::rewindTo(uint64_t tick) {
+  tick = std::min(std::max(tick, oldestTick()), newest);
+  newestKeyframe = tick / REWIND_KEYFRAME_TICKS;
+  const Keyframe &start = keyframe(newestKeyframe);
+  RewindState state = start.state;
+  uint64_t offset = start.offset;
+
+  auto next = [&]() { return bytes[offset++ % bytes.size()]; };
+  auto readVarint = [&]() {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      Uint8 byte = next();
+      value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+  };
+  float *fields[5] = {&state.ball.x, &state.ball.y, &state.ball.velX,
+                      &state.ball.velY, &state.animationProgress};
+  for (uint64_t at = start.tick; at < tick; ++at) {
+    Uint8 mask = next();
+    for (int i = 0; i < 5; ++i) {
+      if (mask & (1 << i)) {
+        *fields[i] = bitsFloat(floatBits(*fields[i]) ^ readVarint());
+      }
+    }
+    if (mask & DELTA_BOUNCES) {
+      state.bounces += static_cast<int>(readVarint());
+    }
+    if (mask & DELTA_SIZE) {
+      state.ball.w ^= static_cast<int>(readVarint());
+      state.ball.h ^= static_cast<int>(readVarint());
+    }
+    state.ballInHole = (mask & DELTA_IN_HOLE) != 0;
+  }
+
+  // Carry on recording from here, over what came after
+  written = offset;
+  newest = tick;
+  last = state;
+  while (strokeCount > 0 &&
+         strokeRing[(strokeStart + strokeCount - 1) % strokeRing.size()]
+                 .tick >= tick) {
+    --strokeCount;
+  }
+  return state;
+}
+
+bool RewindBuffer::undoStroke(RewindState &state) {
+  if (strokeCount == 0) {
+    return false;
+  }
+  const Stroke stroke =
+      strokeRing[(strokeStart + strokeCount - 1) % strokeRing.size()];
+  if (stroke.tick >= oldestTick() && stroke.tick <= newest) {
+    rewindTo(stroke.tick);
+  } else {
+    // Its ticks are gone, but the stroke kept its own keyframe
+    --strokeCount;
+    restart(stroke.tick, stroke.state);
+  }
+  state = stroke.state;
+  return true;
+}
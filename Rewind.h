@@ -0,0 +1,107 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "Physics.h"
+#include <SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ticks between keyframes; seeking decodes at most this many deltas
+const int REWIND_KEYFRAME_TICKS = 64;
+// Moving ball kept at DEFAULT_TICK_RATE; a ball at rest takes no room
+const int REWIND_HISTORY_SECONDS = 600;
+// Keyframes kept, enough to span the history
+const int REWIND_MAX_KEYFRAMES =
+    REWIND_HISTORY_SECONDS * DEFAULT_TICK_RATE / REWIND_KEYFRAME_TICKS + 1;
+// Room for the deltas between keyframes. A moving ball takes 12 to 13 bytes
+// a tick, so with the keyframes this stays under 1 MB.
+const size_t REWIND_BUFFER_BYTES =
+    static_cast<size_t>(REWIND_HISTORY_SECONDS) * DEFAULT_TICK_RATE * 13;
+// Strokes that can be undone
+const int REWIND_MAX_STROKES = 256;
+// How far back one press of the rewind key goes
+const double REWIND_SECONDS = 2.0;
+
+// Everything about a level in play that changes from tick to tick. The
+// layout itself never does, so it isn't stored.
+struct RewindState {
+  Ball ball;
+  int bounces;
+  bool ballInHole;
+  float animationProgress;
+};
+
+// History of one level for rewinding and undoing strokes, in fixed memory
+// however long it is played. Every recorded tick is a delta from the one
+// before, a mask byte and the changed fields, with a float stored as the
+// XOR of its bits with its previous value so a small change takes a byte
+// or two. Every REWIND_KEYFRAME_TICKS ticks the full state is kept as a
+// keyframe instead, so any tick is found in constant time by decoding from
+// the keyframe before it; the oldest ticks are forgotten once the buffer is
+// full. Each stroke also keeps a keyframe of its own, so it can be undone
+// long after the ticks around it are gone.
+//
+// Ticks are counted from the start of the level and only advance when
+// record() is given a state that differs from the newest, so time spent
+// waiting for a shot takes no room. The count is then the same whether or
+// not the caller records while the ball rests, as a replay does.
+class RewindBuffer {
+public:
+  RewindBuffer();
+
+  // Forgets everything, including strokes, and starts over from state as
+  // tick 0
+  void reset(const RewindState &state);
+  // Adds the state one tick after the newest, unless nothing changed
+  void record(const RewindState &state);
+  // Notes that a stroke is about to be played from the newest state
+  void markStroke();
+
+  uint64_t newestTick() const { return newest; }
+  uint64_t oldestTick() const;
+  size_t strokes() const { return strokeCount; }
+  // Fixed memory held, for reporting
+  size_t memoryBytes() const;
+
+  // Returns the state at tick, or the oldest one still kept, and forgets
+  // everything after it, strokes included
+  RewindState rewindTo(uint64_t tick);
+  // Returns the state from just before the newest stroke and forgets
+  // everything from there on; false if there is no stroke to undo
+  bool undoStroke(RewindState &state);
+
+private:
+  struct Keyframe {
+    RewindState state;
+    uint64_t tick;   // Usually a multiple of REWIND_KEYFRAME_TICKS
+    uint64_t offset; // Where its deltas start, in bytes ever written
+  };
+  struct Stroke {
+    RewindState state;
+    uint64_t tick;
+  };
+
+  // Starts a new history at tick from state, keeping the strokes
+  void restart(uint64_t tick, const RewindState &state);
+  Keyframe &keyframe(uint64_t index) {
+    return keyframes[index % REWIND_MAX_KEYFRAMES];
+  }
+  const Keyframe &keyframe(uint64_t index) const {
+    return keyframes[index % REWIND_MAX_KEYFRAMES];
+  }
+
+  std::vector<Uint8> bytes; // Ring of deltas
+  uint64_t written;         // Bytes ever written; bytes[written % size] next
+  std::vector<Keyframe> keyframes;
+  // Keyframe i starts tick i * REWIND_KEYFRAME_TICKS or, for the first
+  // after a restart, the tick it restarted at
+  uint64_t oldestKeyframe, newestKeyframe;
+  uint64_t newest;
+  RewindState last; // At newest; deltas are taken from it
+
+  std::vector<Stroke> strokeRing; // Oldest at strokeStart
+  size_t strokeStart, strokeCount;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstdint>
+#include <cstring>
+
+// Eight floats processed together: one AVX register when the compiler
+// targets AVX, two SSE2 registers on any other x86-64 build, and a plain
+// array elsewhere. Comparisons return lanes with every bit set where true,
+// for use with select() and the bitwise operators.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) ||                                 \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#endif
+
+const int SIMD_LANES = 8;
+
+struct Lanes {
+#if defined(SIMD_AVX)
+  __m256 v;
+#elif defined(SIMD_SSE2)
+  __m128 lo, hi;
+#else
+  float v[SIMD_LANES];
+#endif
+};
+
+#if defined(SIMD_AVX)
+
+inline Lanes lanesBroadcast(float f) { return {_mm256_set1_ps(f)}; }
+inline Lanes lanesLoad(const float *p) { return {_mm256_loadu_ps(p)}; }
+inline void lanesStore(float *p, Lanes a) { _mm256_storeu_ps(p, a.v); }
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline Lanes operator&(Lanes a, Lanes b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline Lanes operator|(Lanes a, Lanes b) { return {_mm256_or_ps(a.v, b.v)}; }
+// ~a & b
+inline Lanes andNot(Lanes a, Lanes b) { return {_mm256_andnot_ps(a.v, b.v)}; }
+inline Lanes min(Lanes a, Lanes b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Lanes max(Lanes a, Lanes b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline Lanes lessThan(Lanes a, Lanes b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+inline Lanes lessEqual(Lanes a, Lanes b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};
+}
+inline Lanes equal(Lanes a, Lanes b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)};
+}
+// Bit i is set if lane i of mask is
+inline int laneBits(Lanes mask) { return _mm256_movemask_ps(mask.v); }
+
+#elif defined(SIMD_SSE2)
+
+inline Lanes lanesBroadcast(float f) {
+  return {_mm_set1_ps(f), _mm_set1_ps(f)};
+}
+inline Lanes lanesLoad(const float *p) {
+  return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)};
+}
+inline void lanesStore(float *p, Lanes a) {
+  _mm_storeu_ps(p, a.lo);
+  _mm_storeu_ps(p + 4, a.hi);
+}
+inline Lanes operator+(Lanes a, Lanes b) {
+  return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)};
+}
+inline Lanes operator-(Lanes a, Lanes b) {
+  return {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)};
+}
+inline Lanes operator*(Lanes a, Lanes b) {
+  return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)};
+}
+inline Lanes operator/(Lanes a, Lanes b) {
+  return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)};
+}
+inline Lanes operator&(Lanes a, Lanes b) {
+  return {_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)};
+}
+inline Lanes operator|(Lanes a, Lanes b) {
+  return {_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)};
+}
+// ~a & b
+inline Lanes andNot(Lanes a, Lanes b) {
+  return {_mm_andnot_ps(a.lo, b.lo), _mm_andnot_ps(a.hi, b.hi)};
+}
+inline Lanes min(Lanes a, Lanes b) {
+  return {_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)};
+}
+inline Lanes max(Lanes a, Lanes b) {
+  return {_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)};
+}
+inline Lanes lessThan(Lanes a, Lanes b) {
+  return {_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)};
+}
+inline Lanes lessEqual(Lanes a, Lanes b) {
+  return {_mm_cmple_ps(a.lo, b.lo), _mm_cmple_ps(a.hi, b.hi)};
+}
+inline Lanes equal(Lanes a, Lanes b) {
+  return {_mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi)};
+}
+// Bit i is set if lane i of mask is
+inline int laneBits(Lanes mask) {
+  return _mm_movemask_ps(mask.lo) | _mm_movemask_ps(mask.hi) << 4;
+}
+
+#else
+
+// Portable fallback; the loops are simple enough for auto-vectorization
+template <typename Op> inline Lanes lanesApply(Lanes a, Lanes b, Op op) {
+  Lanes result;
+  for (int i = 0; i < SIMD_LANES; ++i) {
+    result.v[i] = op(a.v[i], b.v[i]);
+  }
+  return result;
+}
+template <typename Op> inline Lanes lanesBits(Lanes a, Lanes b, Op op) {
+  return lanesApply(a, b, [op](float x, float y) {
+    uint32_t bx, by;
+    std::memcpy(&bx, &x, sizeof(bx));
+    std::memcpy(&by, &y, sizeof(by));
+    uint32_t bits = op(bx, by);
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+  });
+}
+inline float laneMask(bool set) {
+  uint32_t bits = set ? 0xFFFFFFFFu : 0;
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+inline Lanes lanesBroadcast(float f) {
+  Lanes result;
+  for (int i = 0; i < SIMD_LANES; ++i) {
+    result.v[i] = f;
+  }
+  return result;
+}
+inline Lanes lanesLoad(const float *p) {
+  Lanes result;
+  std::memcpy(result.v, p, sizeof(result.v));
+  return result;
+}
+inline void lanesStore(float *p, Lanes a) {
+  std::memcpy(p, a.v, sizeof(a.v));
+}
+inline Lanes operator+(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return x + y; });
+}
+inline Lanes operator-(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return x - y; });
+}
+inline Lanes operator*(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return x * y; });
+}
+inline Lanes operator/(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return x / y; });
+}
+inline Lanes operator&(Lanes a, Lanes b) {
+  return lanesBits(a, b, [](uint32_t x, uint32_t y) { return x & y; });
+}
+inline Lanes operator|(Lanes a, Lanes b) {
+  return lanesBits(a, b, [](uint32_t x, uint32_t y) { return x | y; });
+}
+// ~a & b
+inline Lanes andNot(Lanes a, Lanes b) {
+  return lanesBits(a, b, [](uint32_t x, uint32_t y) { return ~x & y; });
+}
+// Operand order matches minps/maxps, which return b when either is NaN
+inline Lanes min(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return x < y ? x : y; });
+}
+inline Lanes max(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return x > y ? x : y; });
+}
+inline Lanes lessThan(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return laneMask(x < y); });
+}
+inline Lanes lessEqual(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return laneMask(x <= y); });
+}
+inline Lanes equal(Lanes a, Lanes b) {
+  return lanesApply(a, b, [](float x, float y) { return laneMask(x == y); });
+}
+// Bit i is set if lane i of mask is
+inline int laneBits(Lanes mask) {
+  int bits = 0;
+  for (int i = 0; i < SIMD_LANES; ++i) {
+    uint32_t lane;
+    std::memcpy(&lane, &mask.v[i], sizeof(lane));
+    bits |= static_cast<int>(lane >> 31) << i;
+  }
+  return bits;
+}
+
+#endif
+
+// mask ? a : b, lane by lane
+inline Lanes select(Lanes mask, Lanes a, Lanes b) {
+  return (mask & a) | andNot(mask, b);
+}
+inline Lanes greaterThan(Lanes a, Lanes b) { return lessThan(b, a); }
+inline Lanes greaterEqual(Lanes a, Lanes b) { return lessEqual(b, a); }
+inline Lanes abs(Lanes a) { return andNot(lanesBroadcast(-0.0f), a); }
+
+#endif
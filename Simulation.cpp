@@ -0,0 +1,360 @@
+#include "Simulation.h"
+#include "Audio.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// How hard a ball moving at speed was hit, from 0 to 1; speed is in pixels
+// per reference tick, as in Ball
+static float impactStrength(float speed) {
+  return std::min(1.0f, speed / (MAX_PRESS_DURATION / 5.0f));
+}
+
+// Plays sound louder and higher the harder the ball was hit
+static void playImpact(const Mix_Chunk *sound, float speed) {
+  float strength = impactStrength(speed);
+  Audio::play(sound, 0.3f + 0.7f * strength, 0.85f + 0.3f * strength);
+}
+
+Simulation::Simulation(LevelStreamer &streamer, ReplayWriter &writer,
+                       const Replay *replay, Mix_Chunk *clickSound,
+                       Mix_Chunk *holeSound, int tickRate, uint64_t firstSeed,
+                       Uint32 wakeEvent)
+    : streamer(streamer), writer(writer), replay(replay), nextRecord(0),
+      clickSound(clickSound), holeSound(holeSound), tickRate(tickRate),
+      holeOutTicks(std::max<uint64_t>(
+          1, static_cast<uint64_t>(HOLE_OUT_SECONDS * tickRate))),
+      wakeEvent(wakeEvent), courseSeed(0), par(0), parPending(false),
+      levelSeed(firstSeed), tick(0), holedOutTick(0),
+      state(replay ? GAME_RUNNING : START_SCREEN), bounces(0),
+      ballInHole(false), animationProgress(0.0f), publishedIdle(false),
+      stopping(false) {}
+
+Simulation::~Simulation() { stop(); }
+
+bool Simulation::start() {
+  // The built-in course first, then generated ones from the first seed on
+  if (!startLevel(0)) {
+    return false;
+  }
+  requestNextLevel();
+  publish();
+  snapshots.update();
+  thread = std::thread(&Simulation::run, this);
+  return true;
+}
+
+void Simulation::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+bool Simulation::send(const Input &input) {
+  if (!inputs.push(input)) {
+    return false;
+  }
+  // Taking the lock orders the push before the thread's check for input,
+  // so it can't miss it and sleep through the wake-up
+  { std::lock_guard<std::mutex> lock(mutex); }
+  wake.notify_one();
+  return true;
+}
+
+void Simulation::run() {
+  const Clock::duration tickPeriod =
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / tickRate));
+  const Clock::duration maxCatchUp =
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(MAX_CATCH_UP_SECONDS));
+  Clock::time_point nextTick = Clock::now();
+
+  while (!stopping) {
+    bool changed = applyInputs();
+    changed |= updatePar();
+
+    if (isIdle()) {
+      if (changed) {
+        publish();
+      }
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait_for(lock, std::chrono::milliseconds(IDLE_WAIT_MS),
+                      [&] { return stopping || !inputs.empty(); });
+      }
+      // Ticks aren't simulated while idle, since nothing would change, but
+      // they're counted so recorded strokes keep their real timing
+      Clock::time_point now = Clock::now();
+      if (now > nextTick) {
+        tick += (now - nextTick) / tickPeriod;
+      }
+      nextTick = now;
+      continue;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (now < nextTick) {
+      std::this_thread::sleep_until(nextTick);
+      continue;
+    }
+    // After a stall, drop the time beyond maxCatchUp instead of spending the
+    // next ticks catching up on it
+    if (now - nextTick > maxCatchUp) {
+      nextTick = now - maxCatchUp;
+    }
+    step();
+    nextTick += tickPeriod;
+    publish();
+  }
+}
+
+bool Simulation::applyInputs() {
+  bool changed = false;
+  Input input;
+  while (inputs.pop(input)) {
+    changed |= apply(input);
+  }
+  return changed;
+}
+
+bool Simulation::apply(const Input &input) {
+  switch (input.type) {
+  case INPUT_START:
+    if (state != START_SCREEN) {
+      return false;
+    }
+    state = GAME_RUNNING;
+    return true;
+  case INPUT_SHOT:
+    if (state != GAME_RUNNING || ballInHole || ball.velX != 0 ||
+        ball.velY != 0) {
+      return false;
+    }
+    writer.shot(tick, input.targetX, input.targetY, input.pressDuration);
+    launch(input.targetX, input.targetY, input.pressDuration);
+    return true;
+  case INPUT_NEXT_LEVEL:
+    if (state != GAME_COMPLETED) {
+      return false;
+    }
+    // Swap in the next level of the session's seed sequence, prepared while
+    // this one was played, and start on the one after
+    if (startLevel(++levelSeed)) {
+      writer.level(tick, levelSeed);
+    }
+    requestNextLevel();
+    state = GAME_RUNNING;
+    return true;
+  case INPUT_REWIND: {
+    if (state == START_SCREEN) {
+      return false;
+    }
+    uint64_t ticks = static_cast<uint64_t>(REWIND_SECONDS * tickRate);
+    writer.rewind(tick, ticks);
+    rewind(ticks);
+    return true;
+  }
+  case INPUT_UNDO:
+    if (state == START_SCREEN || history.strokes() == 0) {
+      return false;
+    }
+    writer.undo(tick);
+    undo();
+    return true;
+  }
+  return false;
+}
+
+void Simulation::launch(int targetX, int targetY, Uint32 pressDuration) {
+  history.markStroke();
+  launchBall(ball, targetX, targetY, pressDuration);
+  playImpact(clickSound, std::hypot(ball.velX, ball.velY));
+}
+
+// Goes back up to ticks of history, counting only ticks in which something
+// moved, no further than the level's start or the oldest tick still kept
+void Simulation::rewind(uint64_t ticks) {
+  uint64_t newest = history.newestTick();
+  restore(history.rewindTo(ticks < newest ? newest - ticks : 0));
+}
+
+void Simulation::undo() {
+  RewindState saved;
+  if (history.undoStroke(saved)) {
+    restore(saved);
+  }
+}
+
+RewindState Simulation::rewindState() const {
+  return {ball, bounces, ballInHole, animationProgress};
+}
+
+// Puts the level back as it was at some earlier tick. Only ticks played on
+// the course are recorded, so that's where it resumes, even from the
+// level-complete screen.
+void Simulation::restore(const RewindState &saved) {
+  ball = saved.ball;
+  previousBall = ball;
+  bounces = saved.bounces;
+  ballInHole = saved.ballInHole;
+  animationProgress = saved.animationProgress;
+  state = GAME_RUNNING;
+  effects.push(
+      {EFFECT_REWIND, ball.x + ball.w / 2.0f, ball.y + ball.h / 2.0f, 0.0f});
+}
+
+// Switches to the level for seed and puts the ball on its tee. Keeps the
+// current level if the seed has no playable layout. Only waits if streamer
+// wasn't asked for seed early enough, and then only for the layout.
+bool Simulation::startLevel(uint64_t seed) {
+  std::shared_ptr<Course> next = std::make_shared<Course>();
+  if (!streamer.take(seed, next->level, next->grid)) {
+    std::cerr << "No playable layout for seed " << seed << std::endl;
+    return false;
+  }
+  course = next;
+  courseSeed = seed;
+  // The layout comes before its par, which turns up in a later loop
+  par = 0;
+  parPending = true;
+  updatePar();
+
+  // Reset the ball position, velocity and bounce count
+  placeBall(ball, course->level.ballRect);
+  previousBall = ball;
+  ballInHole = false;
+  bounces = 0;
+  history.reset(rewindState());
+  return true;
+}
+
+// Has the streamer prepare the level that comes after this one: the next
+// seed of the session, or in a replay, the next level it switches to
+void Simulation::requestNextLevel() {
+  if (!replay) {
+    streamer.request(levelSeed + 1);
+    return;
+  }
+  for (size_t i = nextRecord; i < replay->records.size(); ++i) {
+    const ReplayRecord &record = replay->records[i];
+    if (record.type == REPLAY_LEVEL && record.seed != courseSeed) {
+      streamer.request(record.seed);
+      return;
+    }
+  }
+}
+
+bool Simulation::updatePar() {
+  if (!parPending || !streamer.takePar(courseSeed, par)) {
+    return false;
+  }
+  parPending = false;
+  return true;
+}
+
+bool Simulation::isIdle() const {
+  if (replay && nextRecord < replay->records.size()) {
+    return false;
+  }
+  return state == START_SCREEN || state == GAME_COMPLETED ||
+         (state == GAME_RUNNING && ball.velX == 0 && ball.velY == 0 &&
+          !ballInHole);
+}
+
+void Simulation::step() {
+  Uint64 start = SDL_GetPerformanceCounter();
+  previousBall = ball;
+
+  // Recorded input lands before the same tick it came before live
+  for (; replay && nextRecord < replay->records.size() &&
+         replay->records[nextRecord].tick <= tick;
+       ++nextRecord) {
+    const ReplayRecord &record = replay->records[nextRecord];
+    if (record.type == REPLAY_LEVEL) {
+      startLevel(record.seed);
+      requestNextLevel();
+      state = GAME_RUNNING;
+    } else if (record.type == REPLAY_REWIND) {
+      rewind(record.rewindTicks);
+    } else if (record.type == REPLAY_UNDO) {
+      undo();
+    } else {
+      launch(record.targetX, record.targetY, record.pressDuration);
+    }
+    previousBall = ball;
+  }
+  ++tick;
+
+  if (state == GAME_HOLED_OUT && tick >= holedOutTick + holeOutTicks) {
+    state = GAME_COMPLETED;
+  }
+  if (state == GAME_RUNNING) {
+    const Level &level = course->level;
+    BallEvent event = updateBallPosition(
+        ball, false, level.objects.data(), course->grid, level.holeRect,
+        level.bounds, ballInHole, animationProgress, bounces,
+        1.0f / tickRate);
+    // Ticks at rest add nothing, so a replay, which steps through them,
+    // rewinds over the same history as live play, which sleeps through them
+    history.record(rewindState());
+
+    if (event == BALL_ENTERED_HOLE || event == BALL_OUT_OF_BOUNDS) {
+      // The ball jumped; don't draw it sliding to its new spot
+      previousBall = ball;
+    }
+    if (event == BALL_BOUNCED) {
+      // Bounces knock softer than the stroke itself, so a ball rattling
+      // between objects doesn't drown it out
+      float speed = std::hypot(ball.velX, ball.velY);
+      playImpact(clickSound, 0.5f * speed);
+      effects.push({EFFECT_BOUNCE, ball.x + ball.w / 2.0f,
+                    ball.y + ball.h / 2.0f, impactStrength(speed)});
+    } else if (event == BALL_ENTERED_HOLE) {
+      Audio::play(holeSound);
+      effects.push({EFFECT_HOLE, level.holeRect.x + level.holeRect.w / 2.0f,
+                    level.holeRect.y + level.holeRect.h / 2.0f, 1.0f});
+    } else if (event == BALL_SETTLED_IN_HOLE) {
+      // Fade to the level-complete screen over the next ticks
+      holedOutTick = tick;
+      state = GAME_HOLED_OUT;
+    }
+  }
+
+  Profiler::addThreadTime(PROFILE_PHYSICS,
+                          SDL_GetPerformanceCounter() - start);
+}
+
+void Simulation::publish() {
+  bool idle = isIdle();
+  WorldSnapshot &snapshot = snapshots.back();
+  snapshot.course = course;
+  snapshot.ball = ball;
+  // Nothing moves between ticks while idle or off the course
+  snapshot.previousBall = idle || state != GAME_RUNNING ? ball : previousBall;
+  snapshot.time = Clock::now();
+  snapshot.state = state;
+  snapshot.bounces = bounces;
+  snapshot.par = par;
+  snapshot.fade =
+      state == GAME_HOLED_OUT
+          ? std::min(1.0f, static_cast<float>(tick - holedOutTick) /
+                               holeOutTicks)
+          : 0.0f;
+  snapshot.idle = idle;
+  snapshots.publish();
+
+  // The render thread may be asleep waiting for input; let it draw this
+  if (publishedIdle && wakeEvent != static_cast<Uint32>(-1)) {
+    SDL_Event event = {};
+    event.type = wakeEvent;
+    SDL_PushEvent(&event);
+  }
+  publishedIdle = idle;
+}
@@ -0,0 +1,167 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "Level.h"
+#include "LevelStreamer.h"
+#include "Physics.h"
+#include "Render.h"
+#include "Replay.h"
+#include "Rewind.h"
+#include "SpatialGrid.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Longest the simulation falls behind before it drops time rather than
+// catching up on it
+const double MAX_CATCH_UP_SECONDS = 0.25;
+// Length of the fade from a holed ball to the level-complete screen
+const double HOLE_OUT_SECONDS = 1.0;
+// Longest either thread sleeps through an idle spell before checking again
+const Uint32 IDLE_WAIT_MS = 500;
+
+// A level's layout and its obstacle index. Never changed once built, so
+// every snapshot taken while the level is played shares one.
+struct Course {
+  Level level;
+  SpatialGrid grid;
+};
+
+// The world as of one physics tick, for drawing
+struct WorldSnapshot {
+  std::shared_ptr<const Course> course;
+  Ball ball;
+  Ball previousBall; // Before the tick; the ball is drawn between the two
+  std::chrono::steady_clock::time_point time; // When the tick ran
+  GameState state;
+  int bounces;
+  int par; // 0 until the streamer has solved it, or if it isn't known
+  float fade; // As passed to render()
+  // Nothing will change until there's input
+  bool idle;
+};
+
+enum InputType {
+  INPUT_START,
+  INPUT_SHOT,
+  INPUT_NEXT_LEVEL,
+  INPUT_REWIND, // Goes back REWIND_SECONDS
+  INPUT_UNDO    // Takes back the last stroke
+};
+
+enum EffectType { EFFECT_BOUNCE, EFFECT_HOLE, EFFECT_REWIND };
+
+// Something that happened in the world for the render thread to show,
+// centred on (x, y). strength is how hard the ball hit, from 0 to 1.
+// EFFECT_REWIND is the ball jumping back to an earlier state.
+struct Effect {
+  EffectType type;
+  float x, y;
+  float strength;
+};
+
+// Player input forwarded to the simulation; the shot fields are the mouse
+// release point and how long the button was held
+struct Input {
+  InputType type;
+  int targetX, targetY;
+  Uint32 pressDuration;
+};
+
+// Runs the game's physics and rules on a thread of its own at a fixed tick
+// rate, so a slow frame can't hold up input or physics. The render thread
+// sends it input and draws from the newest snapshot it has published.
+class Simulation {
+public:
+  // Shots and level changes go to writer; with replay, its records are
+  // played back as well. wakeEvent is pushed to SDL whenever the world
+  // starts changing again after being idle.
+  Simulation(LevelStreamer &streamer, ReplayWriter &writer,
+             const Replay *replay, Mix_Chunk *clickSound,
+             Mix_Chunk *holeSound, int tickRate, uint64_t firstSeed,
+             Uint32 wakeEvent);
+  ~Simulation();
+  Simulation(const Simulation &) = delete;
+  Simulation &operator=(const Simulation &) = delete;
+
+  // Lays out the built-in course and starts the thread. The first snapshot
+  // is ready when this returns.
+  bool start();
+  void stop();
+
+  // Render thread only. send() returns false if input is backing up.
+  bool send(const Input &input);
+  // Switches to the newest snapshot; false if there's nothing newer
+  bool updateSnapshot() { return snapshots.update(); }
+  const WorldSnapshot &snapshot() const { return snapshots.front(); }
+  // Takes the oldest effect not yet shown; false if there are none
+  bool pollEffect(Effect &effect) { return effects.pop(effect); }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  void run();
+  void step();
+  // Returns true if any input changed the world
+  bool applyInputs();
+  bool apply(const Input &input);
+  void launch(int targetX, int targetY, Uint32 pressDuration);
+  void rewind(uint64_t ticks);
+  void undo();
+  RewindState rewindState() const;
+  void restore(const RewindState &saved);
+  bool startLevel(uint64_t seed);
+  void requestNextLevel();
+  // Returns true if the course's par has just arrived
+  bool updatePar();
+  bool isIdle() const;
+  void publish();
+
+  LevelStreamer &streamer;
+  ReplayWriter &writer;
+  const Replay *replay;
+  size_t nextRecord;
+  Mix_Chunk *clickSound;
+  Mix_Chunk *holeSound;
+  const int tickRate;
+  const uint64_t holeOutTicks;
+  const Uint32 wakeEvent;
+
+  // Owned by the simulation thread once it has started
+  std::shared_ptr<const Course> course;
+  uint64_t courseSeed; // The seed course was taken for
+  int par;
+  bool parPending; // The streamer is still solving the course's par
+  uint64_t levelSeed;
+  uint64_t tick; // Ticks run so far this session; replays are timed in these
+  uint64_t holedOutTick;
+  Ball ball, previousBall;
+  GameState state;
+  int bounces;
+  bool ballInHole;
+  float animationProgress;
+  bool publishedIdle;
+  RewindBuffer history; // Of the current level
+
+  SpscQueue<Input, 64> inputs;
+  // Effects that don't fit are dropped; they're only for show
+  SpscQueue<Effect, 64> effects;
+  TripleBuffer<WorldSnapshot> snapshots;
+
+  // Only for waking the thread while it sleeps through an idle spell
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::atomic<bool> stopping;
+  std::thread thread;
+};
+
+#endif
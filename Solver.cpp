@@ -0,0 +1,234 @@
+#include "Solver.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+
+// Resting spots closer than this are treated as the same spot
+const int SOLVER_SPOT_SIZE = 2;
+
+namespace {
+
+// A resting spot reached by a stroke sequence, linked back to its parent
+struct Node {
+  Ball ball;
+  int parent;
+  Shot shot;
+  int bounces;
+};
+
+// Where one shot from a node ended up
+struct Landing {
+  Ball ball;
+  Shot shot;
+  int bounces;
+  bool holed;
+};
+
+} // namespace
+
+// Plays shot from ball until it rests or drops, as simulateShot does.
+// Returns false if the shot goes out, runs too long or bounces more than
+// bounceLimit times, none of which can be part of a useful solution.
+static bool playShot(const Level &level, const SpatialGrid &grid, Ball &ball,
+                     const Shot &shot, float dt, int bounceLimit,
+                     int &bounces, bool &holed) {
+  bool ballInHole = false;
+  float animationProgress = 0.0f;
+  bounces = 0;
+  holed = false;
+  launchBall(ball, static_cast<int>(ball.x + ball.w / 2) + shot.aimX,
+             static_cast<int>(ball.y + ball.h / 2) + shot.aimY,
+             shot.pressDuration);
+
+  for (int tick = 0; tick < MAX_SHOT_TICKS; ++tick) {
+    BallEvent event =
+        updateBallPosition(ball, false, level.objects.data(), grid,
+                           level.holeRect, level.bounds, ballInHole,
+                           animationProgress, bounces, dt);
+    if (event == BALL_ENTERED_HOLE) {
+      holed = true;
+      return bounces <= bounceLimit;
+    }
+    if (event == BALL_OUT_OF_BOUNDS || bounces > bounceLimit) {
+      return false;
+    }
+    if (ball.velX == 0 && ball.velY == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static Solution buildSolution(const std::vector<Node> &nodes, int parent,
+                              const Shot &lastShot, int bounces) {
+  Solution solution;
+  solution.bounces = bounces;
+  solution.shots.push_back(lastShot);
+  for (int i = parent; nodes[i].parent >= 0; i = nodes[i].parent) {
+    solution.shots.insert(solution.shots.begin(), nodes[i].shot);
+  }
+  return solution;
+}
+
+SolverResult solveLevel(const Level &level, const SpatialGrid &grid,
+                        const Ball &start, WorkPool &pool,
+                        const SolverOptions &options) {
+  SolverResult result;
+  result.shotsSimulated = 0;
+  result.complete = true;
+
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(options.budgetSeconds));
+  const float dt = 1.0f / options.tickRate;
+
+  // Every shot from one node along one angle is a task
+  std::vector<Shot> shots;
+  for (int a = 0; a < options.angles; ++a) {
+    float angle = 2.0f * static_cast<float>(M_PI) * a / options.angles;
+    for (int p = 1; p <= options.powers; ++p) {
+      shots.push_back(
+          {static_cast<int>(std::lround(std::cos(angle) * SOLVER_AIM_RADIUS)),
+           static_cast<int>(std::lround(std::sin(angle) * SOLVER_AIM_RADIUS)),
+           static_cast<Uint32>(MAX_PRESS_DURATION * p / options.powers)});
+    }
+  }
+
+  auto spotKey = [](const Ball &ball) {
+    uint64_t x = static_cast<uint32_t>(ball.x) / SOLVER_SPOT_SIZE;
+    uint64_t y = static_cast<uint32_t>(ball.y) / SOLVER_SPOT_SIZE;
+    return x << 32 | y;
+  };
+
+  std::vector<Node> nodes = {{start, -1, {0, 0, 0}, 0}};
+  std::vector<int> frontier = {0};
+  // Fewest bounces any resting spot has been reached with
+  std::unordered_map<uint64_t, int> visited = {{spotKey(start), 0}};
+  // Fewest bounces of any solution so far, read by every task for pruning
+  std::atomic<int> bestBounces(INT_MAX);
+  std::atomic<long> simulated(0);
+  std::atomic<bool> timedOut(false);
+  float nearestDistance = 0;
+
+  for (int stroke = 1; stroke <= options.maxStrokes && !frontier.empty();
+       ++stroke) {
+    const int tasks = static_cast<int>(frontier.size()) * options.angles;
+    std::vector<std::vector<Landing>> landings(tasks);
+
+    pool.parallelFor(tasks, [&](int task) {
+      if (options.anySolution && bestBounces != INT_MAX) {
+        return;
+      }
+      if ((options.budgetSeconds > 0 && Clock::now() >= deadline) ||
+          (options.cancel && *options.cancel)) {
+        timedOut = true;
+        return;
+      }
+      const Node &node = nodes[frontier[task / options.angles]];
+      const Shot *angleShots = &shots[(task % options.angles) * options.powers];
+      for (int p = 0; p < options.powers; ++p) {
+        // A shot may tie the best solution but never exceed it
+        int best = bestBounces.load(std::memory_order_relaxed);
+        int bounceLimit = best == INT_MAX ? INT_MAX : best - node.bounces;
+        Ball ball = node.ball;
+        int bounces;
+        bool holed;
+        if (bounceLimit < 0 ||
+            !playShot(level, grid, ball, angleShots[p], dt, bounceLimit,
+                      bounces, holed)) {
+          continue;
+        }
+        bounces += node.bounces;
+        landings[task].push_back({ball, angleShots[p], bounces, holed});
+        while (holed && bounces < best &&
+               !bestBounces.compare_exchange_weak(best, bounces)) {
+        }
+      }
+      simulated += options.powers;
+    });
+
+    // Merge in task order so the result doesn't depend on thread timing
+    std::vector<int> nextFrontier;
+    const int best = bestBounces;
+    for (int task = 0; task < tasks; ++task) {
+      const int parent = frontier[task / options.angles];
+      for (const Landing &landing : landings[task]) {
+        if (landing.holed) {
+          if (result.fewestStrokes.shots.empty() ||
+              (static_cast<int>(result.fewestStrokes.shots.size()) == stroke &&
+               landing.bounces < result.fewestStrokes.bounces)) {
+            result.fewestStrokes =
+                buildSolution(nodes, parent, landing.shot, landing.bounces);
+          }
+          if (result.fewestBounces.shots.empty() ||
+              landing.bounces < result.fewestBounces.bounces) {
+            result.fewestBounces =
+                buildSolution(nodes, parent, landing.shot, landing.bounces);
+          }
+          continue;
+        }
+
+        // Spots that can only lead to more bounces than a known solution, or
+        // that were reached before with no more bounces, are dead ends
+        if (landing.bounces >= best) {
+          continue;
+        }
+        auto spot = visited.find(spotKey(landing.ball));
+        if (spot != visited.end() && spot->second <= landing.bounces) {
+          continue;
+        }
+        visited[spotKey(landing.ball)] = landing.bounces;
+        nextFrontier.push_back(static_cast<int>(nodes.size()));
+        nodes.push_back({landing.ball, parent, landing.shot, landing.bounces});
+      }
+    }
+    // Spots nearest the hole go first, so a budget or an early solution
+    // cuts off the least promising ones
+    auto holeDistance = [&](int node) {
+      float dx = nodes[node].ball.x - level.holeRect.x;
+      float dy = nodes[node].ball.y - level.holeRect.y;
+      return dx * dx + dy * dy;
+    };
+    std::stable_sort(nextFrontier.begin(), nextFrontier.end(),
+                     [&](int a, int b) {
+                       return holeDistance(a) < holeDistance(b);
+                     });
+    if (!nextFrontier.empty() &&
+        (result.nearest.shots.empty() ||
+         holeDistance(nextFrontier[0]) < nearestDistance)) {
+      const Node &node = nodes[nextFrontier[0]];
+      nearestDistance = holeDistance(nextFrontier[0]);
+      result.nearest =
+          buildSolution(nodes, node.parent, node.shot, node.bounces);
+    }
+    frontier.swap(nextFrontier);
+
+    if (timedOut ||
+        (!result.fewestStrokes.shots.empty() && !options.fewestBounces)) {
+      break;
+    }
+  }
+
+  result.shotsSimulated = simulated;
+  result.complete = !timedOut;
+  return result;
+}
+
+int computePar(const Level &level, const SpatialGrid &grid, WorkPool &pool,
+               const std::atomic<bool> *cancel) {
+  Ball start;
+  placeBall(start, level.ballRect);
+  // Only the stroke count matters, so any solution at the shallowest depth
+  // will do. Running out of budget cuts off the deepest stroke searched, so
+  // the shallowest solution found before then is still the fewest strokes.
+  SolverOptions options;
+  options.anySolution = true;
+  options.budgetSeconds = PAR_BUDGET_SECONDS;
+  options.cancel = cancel;
+  SolverResult result = solveLevel(level, grid, start, pool, options);
+  return static_cast<int>(result.fewestStrokes.shots.size());
+}
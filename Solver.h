@@ -0,0 +1,74 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "Headless.h"
+#include "Level.h"
+#include "Physics.h"
+#include "SpatialGrid.h"
+#include "WorkPool.h"
+#include <atomic>
+#include <vector>
+
+// Distance of a solver shot's aim point from the ball centre; launchBall
+// only uses its direction
+const int SOLVER_AIM_RADIUS = 1000;
+
+// Longest computePar searches for. Most levels are solved well within it;
+// the few whose shortest solution is deep would otherwise search for
+// minutes.
+const double PAR_BUDGET_SECONDS = 2.0;
+
+struct SolverOptions {
+  int angles = 72;     // Directions tried per stroke, evenly spaced
+  int powers = 16;     // Press durations tried per direction, up to the max
+  int maxStrokes = 3;  // Deepest stroke sequence searched
+  int tickRate = DEFAULT_TICK_RATE;
+  // Keep searching past the fewest strokes for a sequence with fewer bounces
+  bool fewestBounces = false;
+  // Stop at the first solution any thread finds. The stroke count is still
+  // the fewest, but which solution comes back depends on thread timing.
+  bool anySolution = false;
+  // Wall-clock limit in seconds, or 0 for none. Tasks still queued when it
+  // runs out are skipped and the result is marked incomplete.
+  double budgetSeconds = 0;
+  // Set from another thread to stop early, like running out of budget
+  const std::atomic<bool> *cancel = nullptr;
+};
+
+// A stroke sequence that holes the ball; empty shots means none was found
+struct Solution {
+  std::vector<Shot> shots;
+  int bounces = 0;
+};
+
+struct SolverResult {
+  Solution fewestStrokes; // Ties broken by bounces
+  // Searched past the fewest strokes only with SolverOptions::fewestBounces
+  Solution fewestBounces;
+  // Sequence that leaves the ball resting nearest the hole, a fallback hint
+  // when no solution was found in the budget
+  Solution nearest;
+  long shotsSimulated;
+  bool complete; // False if the budget ran out or the search was cancelled
+};
+
+// Searches the angle x power space of strokes from start, stroke by stroke,
+// with the same physics as the game. Each stroke's shots from every distinct
+// resting spot are spread over pool. Shots are pruned once they bounce more
+// than the best solution found so far, and resting spots already reached
+// with fewer bounces are not searched again. grid must index level.objects.
+SolverResult solveLevel(const Level &level, const SpatialGrid &grid,
+                        const Ball &start, WorkPool &pool,
+                        const SolverOptions &options = SolverOptions());
+
+// Strokes the solver needs from the level's start, or 0 if par isn't known:
+// no sequence holes the ball within SolverOptions::maxStrokes, or none was
+// found within PAR_BUDGET_SECONDS. A par it does return is always the
+// fewest strokes, since every shallower stroke was searched in full first.
+// How far a level gets in the budget depends on the machine, so a hard
+// level may have a par on one and none on another. Setting *cancel gives up
+// early the same way.
+int computePar(const Level &level, const SpatialGrid &grid, WorkPool &pool,
+               const std::atomic<bool> *cancel = nullptr);
+
+#endif
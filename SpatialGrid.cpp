@@ -0,0 +1,28 @@
+#include "SpatialGrid.h"
+
+SpatialGrid::SpatialGrid(int cellSize)
+    : cellSize(cellSize), maxWidth(0), maxHeight(0) {}
+
+void SpatialGrid::build(const SDL_Rect rects[], size_t count) {
+  clear();
+  for (size_t i = 0; i < count; ++i) {
+    insert(static_cast<int>(i), rects[i]);
+  }
+}
+
+void SpatialGrid::insert(int index, const SDL_Rect &rect) {
+  if (rect.w > MAX_FILED_CELLS * cellSize ||
+      rect.h > MAX_FILED_CELLS * cellSize) {
+    oversized.push_back(index);
+    return;
+  }
+  maxWidth = std::max(maxWidth, rect.w);
+  maxHeight = std::max(maxHeight, rect.h);
+  cells[key(cellOf(rect.x), cellOf(rect.y))].push_back(index);
+}
+
+void SpatialGrid::clear() {
+  cells.clear();
+  oversized.clear();
+  maxWidth = maxHeight = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform-grid spatial hash over a set of rects, referred to by index.
+// Each rect is filed under the cell holding its top-left corner only, and
+// queries widen their area by the largest filed rect size instead, so a
+// rect is never reported twice and lookups never allocate. Rects wider or
+// taller than MAX_FILED_CELLS cells would widen every query across most of
+// a course, so they are kept in a list every query visits instead.
+class SpatialGrid {
+public:
+  static const int DEFAULT_CELL_SIZE = 64;
+  static const int MAX_FILED_CELLS = 4;
+
+  explicit SpatialGrid(int cellSize = DEFAULT_CELL_SIZE);
+
+  void build(const SDL_Rect rects[], size_t count);
+  void insert(int index, const SDL_Rect &rect);
+  void clear();
+
+  // Calls visit(index) for every oversized rect, then for every rect filed
+  // in a cell that area may reach. Candidates still need an exact overlap
+  // test.
+  template <typename Visit>
+  void query(const SDL_Rect &area, Visit visit) const {
+    for (int index : oversized) {
+      visit(index);
+    }
+    if (cells.empty()) {
+      return;
+    }
+    int firstX = cellOf(area.x - maxWidth);
+    int firstY = cellOf(area.y - maxHeight);
+    int lastX = cellOf(area.x + area.w);
+    int lastY = cellOf(area.y + area.h);
+    for (int cellY = firstY; cellY <= lastY; ++cellY) {
+      for (int cellX = firstX; cellX <= lastX; ++cellX) {
+        auto cell = cells.find(key(cellX, cellY));
+        if (cell == cells.end()) {
+          continue;
+        }
+        for (int index : cell->second) {
+          visit(index);
+        }
+      }
+    }
+  }
+
+private:
+  int cellOf(int coordinate) const {
+    // Floor division so negative coordinates land in the right cell
+    return coordinate >= 0 ? coordinate / cellSize
+                           : (coordinate - cellSize + 1) / cellSize;
+  }
+  static uint64_t key(int cellX, int cellY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) |
+           static_cast<uint32_t>(cellY);
+  }
+
+  int cellSize;
+  int maxWidth;
+  int maxHeight;
+  std::unordered_map<uint64_t, std::vector<int>> cells;
+  std::vector<int> oversized;
+};
+
+#endif
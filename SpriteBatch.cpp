@@ -0,0 +1,72 @@
+#include "SpriteBatch.h"
+#include "Profiler.h"
+#include <cmath>
+
+void SpriteBatch::begin(SDL_Renderer *renderer) {
+  this->renderer = renderer;
+  texture = nullptr;
+  vertices.clear();
+  indices.clear();
+  drawCallCount = 0;
+}
+
+void SpriteBatch::draw(const Sprite &sprite, const SDL_Rect &destination,
+                       double angle) {
+  if (!sprite.texture) {
+    return;
+  }
+  if (sprite.texture != texture) {
+    flush();
+    texture = sprite.texture;
+    int w = 1, h = 1;
+    SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+    textureWidth = static_cast<float>(w);
+    textureHeight = static_cast<float>(h);
+  }
+
+  const float u0 = sprite.source.x / textureWidth;
+  const float v0 = sprite.source.y / textureHeight;
+  const float u1 = (sprite.source.x + sprite.source.w) / textureWidth;
+  const float v1 = (sprite.source.y + sprite.source.h) / textureHeight;
+
+  // Corners relative to the destination centre, rotated in screen space
+  const float halfW = destination.w / 2.0f;
+  const float halfH = destination.h / 2.0f;
+  const float centreX = destination.x + halfW;
+  const float centreY = destination.y + halfH;
+  const float radians = static_cast<float>(angle * M_PI / 180.0);
+  const float cosA = std::cos(radians);
+  const float sinA = std::sin(radians);
+  const float cornerX[4] = {-halfW, halfW, halfW, -halfW};
+  const float cornerY[4] = {-halfH, -halfH, halfH, halfH};
+  const float cornerU[4] = {u0, u1, u1, u0};
+  const float cornerV[4] = {v0, v0, v1, v1};
+
+  const int first = static_cast<int>(vertices.size());
+  for (int i = 0; i < 4; ++i) {
+    SDL_Vertex vertex;
+    vertex.position.x = centreX + cornerX[i] * cosA - cornerY[i] * sinA;
+    vertex.position.y = centreY + cornerX[i] * sinA + cornerY[i] * cosA;
+    vertex.color = {255, 255, 255, 255};
+    vertex.tex_coord.x = cornerU[i];
+    vertex.tex_coord.y = cornerV[i];
+    vertices.push_back(vertex);
+  }
+  const int quad[6] = {0, 1, 2, 0, 2, 3};
+  for (int index : quad) {
+    indices.push_back(first + index);
+  }
+}
+
+void SpriteBatch::flush() {
+  if (!indices.empty()) {
+    SDL_RenderGeometry(renderer, texture, vertices.data(),
+                       static_cast<int>(vertices.size()), indices.data(),
+                       static_cast<int>(indices.size()));
+    ++drawCallCount;
+    Profiler::countDrawCalls();
+  }
+  // Keep the capacity so steady-state frames don't allocate
+  vertices.clear();
+  indices.clear();
+}
@@ -0,0 +1,32 @@
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "TextureManager.h"
+#include <SDL.h>
+#include <vector>
+
+// Collects textured quads and submits each run of sprites that share a
+// texture with a single SDL_RenderGeometry call. Sprites from the atlas are
+// therefore drawn in one call per frame, in the order they were added.
+class SpriteBatch {
+public:
+  void begin(SDL_Renderer *renderer);
+  // angle is in degrees clockwise about the destination centre, as with
+  // SDL_RenderCopyEx
+  void draw(const Sprite &sprite, const SDL_Rect &destination,
+            double angle = 0.0);
+  void flush();
+
+  int drawCalls() const { return drawCallCount; }
+
+private:
+  SDL_Renderer *renderer = nullptr;
+  SDL_Texture *texture = nullptr;
+  float textureWidth = 1.0f;
+  float textureHeight = 1.0f;
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices;
+  int drawCallCount = 0;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+
+// Fixed-capacity queue from one producer thread to one consumer thread.
+// push() and pop() never block or allocate.
+template <typename T, unsigned Capacity> class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  SpscQueue() : head(0), tail(0) {}
+
+  // Producer side; returns false if the queue is full
+  bool push(const T &value) {
+    unsigned back = tail.load(std::memory_order_relaxed);
+    if (back - head.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    items[back % Capacity] = value;
+    tail.store(back + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side; returns false if the queue is empty
+  bool pop(T &value) {
+    unsigned front = head.load(std::memory_order_relaxed);
+    if (front == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = items[front % Capacity];
+    head.store(front + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+private:
+  T items[Capacity];
+  std::atomic<unsigned> head;
+  std::atomic<unsigned> tail;
+};
+
+#endif
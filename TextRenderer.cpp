@@ -0,0 +1,183 @@
+#include "TextRenderer.h"
+#include "Profiler.h"
+#include "TextureManager.h"
+#include <algorithm>
+#include <iostream>
+
+// Static members
+SDL_Renderer *TextRenderer::gRenderer = nullptr;
+std::map<std::string, TextRenderer::GlyphAtlas> TextRenderer::atlases;
+std::map<std::string, std::map<std::string, TextRenderer::CachedText>>
+    TextRenderer::cache;
+Uint32 TextRenderer::useCounter = 0;
+
+void TextRenderer::init(SDL_Renderer *renderer) { gRenderer = renderer; }
+
+void TextRenderer::freeText() {
+  for (auto &pair : atlases) {
+    SDL_DestroyTexture(pair.second.texture);
+  }
+  atlases.clear();
+  for (auto &font : cache) {
+    for (auto &pair : font.second) {
+      SDL_DestroyTexture(pair.second.texture);
+    }
+  }
+  cache.clear();
+}
+
+bool TextRenderer::buildAtlas(TTF_Font *font, GlyphAtlas &atlas) {
+  const SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *glyphSurfaces[NUM_GLYPHS] = {};
+
+  // Lay the glyphs out in a single row; the ASCII range is small enough
+  int width = 0, height = 0;
+  for (int i = 0; i < NUM_GLYPHS; ++i) {
+    Uint16 glyph = static_cast<Uint16>(FIRST_GLYPH + i);
+    int advance = 0;
+    TTF_GlyphMetrics(font, glyph, nullptr, nullptr, nullptr, nullptr,
+                     &advance);
+    atlas.advances[i] = advance;
+
+    glyphSurfaces[i] = TTF_RenderGlyph_Solid(font, glyph, white);
+    if (glyphSurfaces[i]) {
+      atlas.glyphs[i] = {width, 0, glyphSurfaces[i]->w, glyphSurfaces[i]->h};
+      width += glyphSurfaces[i]->w + 1;
+      height = std::max(height, glyphSurfaces[i]->h);
+    } else {
+      atlas.glyphs[i] = {0, 0, 0, 0};
+    }
+  }
+
+  SDL_Surface *atlasSurface = SDL_CreateRGBSurfaceWithFormat(
+      0, std::max(width, 1), std::max(height, 1), 32, SDL_PIXELFORMAT_RGBA32);
+  if (atlasSurface) {
+    SDL_FillRect(atlasSurface, nullptr, 0);
+    for (int i = 0; i < NUM_GLYPHS; ++i) {
+      if (glyphSurfaces[i]) {
+        SDL_BlitSurface(glyphSurfaces[i], nullptr, atlasSurface,
+                        &atlas.glyphs[i]);
+      }
+    }
+  }
+  for (SDL_Surface *surface : glyphSurfaces) {
+    SDL_FreeSurface(surface);
+  }
+  if (!atlasSurface) {
+    std::cerr << "Unable to create glyph atlas! SDL Error: " << SDL_GetError()
+              << std::endl;
+    return false;
+  }
+
+  atlas.texture = SDL_CreateTextureFromSurface(gRenderer, atlasSurface);
+  Profiler::countTextureCreation();
+  SDL_FreeSurface(atlasSurface);
+  if (!atlas.texture) {
+    std::cerr << "Unable to create glyph atlas texture! SDL Error: "
+              << SDL_GetError() << std::endl;
+    return false;
+  }
+  SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+  return true;
+}
+
+TextRenderer::GlyphAtlas *TextRenderer::getAtlas(const std::string &fontName) {
+  auto found = atlases.find(fontName);
+  if (found != atlases.end()) {
+    return found->second.texture ? &found->second : nullptr;
+  }
+
+  // A failed build is remembered so it isn't retried every frame
+  GlyphAtlas &atlas = atlases[fontName];
+  atlas.texture = nullptr;
+  TTF_Font *font = TextureManager::getFont(fontName);
+  if (!font || !buildAtlas(font, atlas)) {
+    return nullptr;
+  }
+  return &atlas;
+}
+
+void TextRenderer::drawText(const std::string &fontName,
+                            const std::string &text, int x, int y,
+                            SDL_Color color) {
+  GlyphAtlas *atlas = getAtlas(fontName);
+  if (!atlas) {
+    return;
+  }
+
+  SDL_SetTextureColorMod(atlas->texture, color.r, color.g, color.b);
+  SDL_SetTextureAlphaMod(atlas->texture, color.a);
+  for (char c : text) {
+    int index = static_cast<unsigned char>(c) - FIRST_GLYPH;
+    if (index < 0 || index >= NUM_GLYPHS) {
+      index = '?' - FIRST_GLYPH;
+    }
+    const SDL_Rect &glyph = atlas->glyphs[index];
+    SDL_Rect destination = {x, y, glyph.w, glyph.h};
+    SDL_RenderCopy(gRenderer, atlas->texture, &glyph, &destination);
+    Profiler::countDrawCalls();
+    x += atlas->advances[index];
+  }
+}
+
+TextRenderer::CachedText *
+TextRenderer::getCachedText(const std::string &fontName,
+                            const std::string &text) {
+  std::map<std::string, CachedText> &fontCache = cache[fontName];
+  auto found = fontCache.find(text);
+  if (found != fontCache.end()) {
+    found->second.lastUsed = ++useCounter;
+    return &found->second;
+  }
+
+  TTF_Font *font = TextureManager::getFont(fontName);
+  if (!font) {
+    return nullptr;
+  }
+  const SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *textSurface = TTF_RenderText_Solid(font, text.c_str(), white);
+  if (!textSurface) {
+    std::cerr << "Unable to render text surface! SDL_ttf Error: "
+              << TTF_GetError() << std::endl;
+    return nullptr;
+  }
+  SDL_Texture *textTexture =
+      SDL_CreateTextureFromSurface(gRenderer, textSurface);
+  Profiler::countTextureCreation();
+  CachedText entry = {textTexture, textSurface->w, textSurface->h,
+                      ++useCounter};
+  SDL_FreeSurface(textSurface);
+  if (!textTexture) {
+    std::cerr << "Unable to create text texture! SDL Error: "
+              << SDL_GetError() << std::endl;
+    return nullptr;
+  }
+
+  // Drop the least recently drawn string once the font's cache is full
+  if (fontCache.size() >= MAX_CACHED_TEXTS) {
+    auto oldest = fontCache.begin();
+    for (auto it = fontCache.begin(); it != fontCache.end(); ++it) {
+      if (it->second.lastUsed < oldest->second.lastUsed) {
+        oldest = it;
+      }
+    }
+    SDL_DestroyTexture(oldest->second.texture);
+    fontCache.erase(oldest);
+  }
+  return &(fontCache[text] = entry);
+}
+
+void TextRenderer::drawCachedText(const std::string &fontName,
+                                  const std::string &text, int x, int y,
+                                  SDL_Color color) {
+  CachedText *cached = getCachedText(fontName, text);
+  if (!cached) {
+    return;
+  }
+
+  SDL_SetTextureColorMod(cached->texture, color.r, color.g, color.b);
+  SDL_SetTextureAlphaMod(cached->texture, color.a);
+  SDL_Rect textRect = {x, y, cached->w, cached->h};
+  SDL_RenderCopy(gRenderer, cached->texture, nullptr, &textRect);
+  Profiler::countDrawCalls();
+}
@@ -0,0 +1,55 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <map>
+#include <string>
+
+// HUD text on top of the fonts loaded by TextureManager. Nothing here
+// rasterizes or uploads per frame unless the text itself is new.
+class TextRenderer {
+public:
+  static void init(SDL_Renderer *renderer);
+  // Draws text glyph by glyph from the font's atlas, which is built on first
+  // use. Suits text that changes every frame, such as timers.
+  static void drawText(const std::string &fontName, const std::string &text,
+                       int x, int y, SDL_Color color);
+  // Draws text from a texture cached per string, rasterized only the first
+  // time that string is seen. Suits labels and counters that rarely change.
+  static void drawCachedText(const std::string &fontName,
+                             const std::string &text, int x, int y,
+                             SDL_Color color);
+  static void freeText();
+
+private:
+  // Printable ASCII, rendered once per font into a single texture
+  static const int FIRST_GLYPH = 32;
+  static const int LAST_GLYPH = 126;
+  static const int NUM_GLYPHS = LAST_GLYPH - FIRST_GLYPH + 1;
+  // Cached strings kept per font before the least recently drawn is evicted
+  static const size_t MAX_CACHED_TEXTS = 32;
+
+  struct GlyphAtlas {
+    SDL_Texture *texture;
+    SDL_Rect glyphs[NUM_GLYPHS];
+    int advances[NUM_GLYPHS];
+  };
+  struct CachedText {
+    SDL_Texture *texture;
+    int w, h;
+    Uint32 lastUsed;
+  };
+
+  static GlyphAtlas *getAtlas(const std::string &fontName);
+  static bool buildAtlas(TTF_Font *font, GlyphAtlas &atlas);
+  static CachedText *getCachedText(const std::string &fontName,
+                                   const std::string &text);
+
+  static SDL_Renderer *gRenderer;
+  static std::map<std::string, GlyphAtlas> atlases;
+  static std::map<std::string, std::map<std::string, CachedText>> cache;
+  static Uint32 useCounter;
+};
+
+#endif
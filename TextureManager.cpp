@@ -1,56 +1,251 @@
 #include "TextureManager.h"
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "Profiler.h"
 #include <SDL_image.h>
 #include <SDL_ttf.h>
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <set>
 
 // Static members
 SDL_Renderer *TextureManager::gRenderer = nullptr;
-std::map<std::string, SDL_Texture *> TextureManager::textures;
+Sprite TextureManager::sprites[TEXTURE_COUNT];
+std::vector<SDL_Texture *> TextureManager::ownedTextures;
+std::map<std::string, Sprite> TextureManager::pathSprites;
+std::map<std::string, SDL_Surface *> TextureManager::pendingSurfaces;
 std::map<std::string, TTF_Font *> TextureManager::fonts;
+const AssetPack *TextureManager::assetPack = nullptr;
+
+// Name and file of every texture, in TextureId order
+struct TextureSource {
+  const char *name;
+  const char *path;
+};
+static const TextureSource TEXTURE_SOURCES[] = {
+    {"background", "res/background3.png"},
+    {"ball", "res/ball.png"},
+    {"arrow", "res/arrow.png"},
+    {"startScreen", "res/flash_screen.png"},
+    {"object1", "res/tile100x150_light.png"},
+    {"object2", "res/tile100x150_light.png"},
+    {"object3", "res/tile100x150_light.png"},
+    {"object4", "res/tile100_light.png"},
+    {"object5", "res/tile100_light.png"},
+    {"object6", "res/tile100_light.png"},
+    {"object7", "res/tile100_light.png"},
+    {"object8", "res/tile100_light.png"},
+    {"object9", "res/tile100_light.png"},
+    {"object10", "res/tile100x150_light.png"},
+    {"object11", "res/tile100_light.png"},
+    {"object12", "res/tile100_light.png"},
+    {"hole", "res/hole.png"},
+    {"comScreen", "res/com_background.png"}};
+static_assert(sizeof(TEXTURE_SOURCES) / sizeof(TEXTURE_SOURCES[0]) ==
+                  TEXTURE_COUNT,
+              "every TextureId needs a source");
+
+// Handle for a texture name, or TEXTURE_COUNT if there's no such texture
+static int textureId(const std::string &name) {
+  int id = 0;
+  while (id < TEXTURE_COUNT && name != TEXTURE_SOURCES[id].name) {
+    ++id;
+  }
+  return id;
+}
 
 bool TextureManager::loadTextures(SDL_Renderer *renderer) {
+  AssetLoader loader;
+  queueTextures(renderer, loader);
+  bool decoded = loader.run();
+  return finishTextures() && decoded;
+}
+
+void TextureManager::queueTextures(SDL_Renderer *renderer,
+                                   AssetLoader &loader) {
   gRenderer = renderer;
 
-  // List of textures to load
-  std::map<std::string, std::string> texturePaths = {
-      {"background", "res/background3.png"},
-      {"ball", "res/ball.png"},
-      {"arrow", "res/arrow.png"},
-      {"startScreen", "res/flash_screen.png"},
-      {"object1", "res/tile100x150_light.png"},
-      {"object2", "res/tile100x150_light.png"},
-      {"object3", "res/tile100x150_light.png"},
-      {"object4", "res/tile100_light.png"},
-      {"object5", "res/tile100_light.png"},
-      {"object6", "res/tile100_light.png"},
-      {"object7", "res/tile100_light.png"},
-      {"object8", "res/tile100_light.png"},
-      {"object9", "res/tile100_light.png"},
-      {"object10", "res/tile100x150_light.png"},
-      {"object11", "res/tile100_light.png"},
-      {"object12", "res/tile100_light.png"},
-      {"hole", "res/hole.png"},
-      {"comScreen", "res/com_background.png"}};
-
-  // Load all textures
-  for (const auto &pair : texturePaths) {
-    textures[pair.first] = loadTexture(pair.second);
-    if (!textures[pair.first]) {
-      std::cerr << "Failed to load texture: " << pair.first << std::endl;
-      return false;
+  // Decode each file once, however many names share it
+  std::set<std::string> queued;
+  for (const TextureSource &source : TEXTURE_SOURCES) {
+    const std::string path = source.path;
+    if (!queued.insert(path).second) {
+      continue;
+    }
+
+    // Packed images are already RGBA; wrap the mapped pixels directly
+    const AssetPackEntry *entry =
+        assetPack ? assetPack->find(path) : nullptr;
+    if (entry && entry->type == ASSET_TEXTURE) {
+      // The surface only ever reads from the mapped pixels
+      SDL_Surface *mapped = SDL_CreateRGBSurfaceWithFormatFrom(
+          const_cast<Uint8 *>(assetPack->data(*entry)), entry->width,
+          entry->height, 32, entry->pitch, SDL_PIXELFORMAT_RGBA32);
+      loader.add([path, mapped]() -> AssetLoader::Finish {
+        std::string error = mapped ? "" : "Unable to wrap packed pixels";
+        return [path, mapped, error]() {
+          return uploadSurface(path, mapped, error);
+        };
+      });
+      continue;
+    }
+
+    loader.add([path]() -> AssetLoader::Finish {
+      SDL_Surface *loadedSurface = IMG_Load(path.c_str());
+      std::string error = loadedSurface ? "" : IMG_GetError();
+      return [path, loadedSurface, error]() {
+        return uploadSurface(path, loadedSurface, error);
+      };
+    });
+  }
+}
+
+bool TextureManager::uploadSurface(const std::string &path,
+                                   SDL_Surface *surface,
+                                   const std::string &error) {
+  if (!surface) {
+    std::cerr << "Unable to load image " << path
+              << "! SDL_image Error: " << error << std::endl;
+    return false;
+  }
+
+  // Small images wait for the atlas; large ones get their own texture now
+  if (surface->w <= MAX_ATLAS_SPRITE_SIZE &&
+      surface->h <= MAX_ATLAS_SPRITE_SIZE) {
+    pendingSurfaces[path] = surface;
+    return true;
+  }
+
+  SDL_Texture *newTexture = SDL_CreateTextureFromSurface(gRenderer, surface);
+  Profiler::countTextureCreation();
+  SDL_Rect source = {0, 0, surface->w, surface->h};
+  SDL_FreeSurface(surface);
+  if (!newTexture) {
+    std::cerr << "Unable to create texture from " << path
+              << "! SDL Error: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  ownedTextures.push_back(newTexture);
+  pathSprites[path] = {newTexture, source};
+  return true;
+}
+
+bool TextureManager::finishTextures() {
+  bool ok = true;
+  if (!pendingSurfaces.empty()) {
+    std::vector<PackedImage> packed;
+    for (const auto &pair : pendingSurfaces) {
+      packed.push_back(
+          {pair.first, pair.second, {0, 0, pair.second->w, pair.second->h}});
+    }
+    ok = packAtlas(packed);
+    if (ok) {
+      for (const PackedImage &image : packed) {
+        pathSprites[image.path] = {ownedTextures.back(), image.rect};
+      }
+    }
+    for (auto &pair : pendingSurfaces) {
+      SDL_FreeSurface(pair.second);
+    }
+    pendingSurfaces.clear();
+  }
+
+  for (int id = 0; id < TEXTURE_COUNT; ++id) {
+    auto found = pathSprites.find(TEXTURE_SOURCES[id].path);
+    if (found == pathSprites.end()) {
+      std::cerr << "Failed to load texture: " << TEXTURE_SOURCES[id].name
+                << std::endl;
+      ok = false;
+      continue;
+    }
+    sprites[id] = found->second;
+  }
+  pathSprites.clear();
+  return ok;
+}
+
+bool TextureManager::packAtlas(std::vector<PackedImage> &images) {
+  int maxSize = MAX_ATLAS_SIZE;
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(gRenderer, &info) == 0 &&
+      info.max_texture_width > 0) {
+    maxSize = std::min(maxSize, std::min(info.max_texture_width,
+                                         info.max_texture_height));
+  }
+
+  // Shelf packing: tallest first, left to right, a new shelf when a row is
+  // full. The handful of sprites here fit in a single shelf or two.
+  std::vector<PackedImage *> order;
+  int totalWidth = 0;
+  for (PackedImage &image : images) {
+    order.push_back(&image);
+    totalWidth += image.rect.w + 2 * ATLAS_PADDING;
+  }
+  std::sort(order.begin(), order.end(),
+            [](const PackedImage *a, const PackedImage *b) {
+              return a->rect.h > b->rect.h;
+            });
+
+  const int atlasWidth = std::min(totalWidth, maxSize);
+  int x = 0, y = 0, shelfHeight = 0;
+  for (PackedImage *image : order) {
+    int w = image->rect.w + 2 * ATLAS_PADDING;
+    int h = image->rect.h + 2 * ATLAS_PADDING;
+    if (x + w > atlasWidth) {
+      y += shelfHeight;
+      x = 0;
+      shelfHeight = 0;
     }
+    image->rect.x = x + ATLAS_PADDING;
+    image->rect.y = y + ATLAS_PADDING;
+    x += w;
+    shelfHeight = std::max(shelfHeight, h);
+  }
+  const int atlasHeight = y + shelfHeight;
+  if (atlasHeight > maxSize) {
+    std::cerr << "Sprites don't fit in a " << maxSize << "x" << maxSize
+              << " atlas" << std::endl;
+    return false;
   }
 
+  SDL_Surface *atlasSurface = SDL_CreateRGBSurfaceWithFormat(
+      0, atlasWidth, atlasHeight, 32, SDL_PIXELFORMAT_RGBA32);
+  if (!atlasSurface) {
+    std::cerr << "Unable to create sprite atlas! SDL Error: "
+              << SDL_GetError() << std::endl;
+    return false;
+  }
+  SDL_FillRect(atlasSurface, nullptr, 0);
+  for (PackedImage &image : images) {
+    // Copy alpha as-is rather than blending onto the empty atlas
+    SDL_SetSurfaceBlendMode(image.surface, SDL_BLENDMODE_NONE);
+    SDL_Rect destination = image.rect;
+    SDL_BlitSurface(image.surface, nullptr, atlasSurface, &destination);
+  }
+
+  SDL_Texture *atlas = SDL_CreateTextureFromSurface(gRenderer, atlasSurface);
+  Profiler::countTextureCreation();
+  SDL_FreeSurface(atlasSurface);
+  if (!atlas) {
+    std::cerr << "Unable to create sprite atlas texture! SDL Error: "
+              << SDL_GetError() << std::endl;
+    return false;
+  }
+  SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+  ownedTextures.push_back(atlas);
   return true;
 }
 
 void TextureManager::freeTextures() {
-  for (auto &pair : textures) {
-    SDL_DestroyTexture(pair.second);
-    pair.second = nullptr;
+  // Several names can share a texture, so free by owner rather than by name
+  for (SDL_Texture *texture : ownedTextures) {
+    SDL_DestroyTexture(texture);
+  }
+  ownedTextures.clear();
+  for (Sprite &sprite : sprites) {
+    sprite = {nullptr, {0, 0, 0, 0}};
   }
-  textures.clear();
 }
 void TextureManager::freeFonts() {
   for (auto &pair : fonts) {
@@ -61,13 +256,23 @@ void TextureManager::freeFonts() {
 }
 
 SDL_Texture *TextureManager::getTexture(const std::string &name) {
-  if (textures.find(name) != textures.end()) {
-    return textures[name];
+  int id = textureId(name);
+  if (id < TEXTURE_COUNT && sprites[id].texture) {
+    return sprites[id].texture;
   }
   std::cerr << "Texture not found: " << name << std::endl;
   return nullptr;
 }
 
+const Sprite *TextureManager::getSprite(const std::string &name) {
+  int id = textureId(name);
+  if (id < TEXTURE_COUNT && sprites[id].texture) {
+    return &sprites[id];
+  }
+  std::cerr << "Sprite not found: " << name << std::endl;
+  return nullptr;
+}
+
 SDL_Texture *TextureManager::loadTexture(const std::string &path) {
   SDL_Surface *loadedSurface = IMG_Load(path.c_str());
   if (!loadedSurface) {
@@ -78,6 +283,7 @@ SDL_Texture *TextureManager::loadTexture(const std::string &path) {
 
   SDL_Texture *newTexture =
       SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
+  Profiler::countTextureCreation();
   SDL_FreeSurface(loadedSurface);
 
   if (!newTexture) {
@@ -96,9 +302,21 @@ TTF_Font *TextureManager::getFont(const std::string &name) {
   return nullptr;
 }
 
+void TextureManager::setAssetPack(const AssetPack *pack) { assetPack = pack; }
+
 bool TextureManager::loadFonts() {
   // Adjust the path as needed
-  fonts["font"] = TTF_OpenFont("res/font.ttf", 30);
+  const AssetPackEntry *entry =
+      assetPack ? assetPack->find("res/font.ttf") : nullptr;
+  if (entry && entry->type == ASSET_FONT) {
+    // SDL_ttf reads glyphs lazily, so the pack must stay mapped
+    fonts["font"] = TTF_OpenFontRW(
+        SDL_RWFromConstMem(assetPack->data(*entry),
+                           static_cast<int>(entry->size)),
+        1, 30);
+  } else {
+    fonts["font"] = TTF_OpenFont("res/font.ttf", 30);
+  }
   if (!fonts["font"]) {
     std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
     return false;
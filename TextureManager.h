@@ -5,21 +5,91 @@
 #include <SDL_ttf.h>
 #include <map>
 #include <string>
+#include <vector>
+
+// A named image: either a whole texture or a sub-rect of the sprite atlas
+struct Sprite {
+  SDL_Texture *texture;
+  SDL_Rect source;
+};
+
+// Every texture the game draws. Handles index a flat table, so the frame
+// path looks textures up without building strings or walking a map.
+enum TextureId {
+  TEXTURE_BACKGROUND,
+  TEXTURE_BALL,
+  TEXTURE_ARROW,
+  TEXTURE_START_SCREEN,
+  TEXTURE_OBJECT1,
+  TEXTURE_OBJECT2,
+  TEXTURE_OBJECT3,
+  TEXTURE_OBJECT4,
+  TEXTURE_OBJECT5,
+  TEXTURE_OBJECT6,
+  TEXTURE_OBJECT7,
+  TEXTURE_OBJECT8,
+  TEXTURE_OBJECT9,
+  TEXTURE_OBJECT10,
+  TEXTURE_OBJECT11,
+  TEXTURE_OBJECT12,
+  TEXTURE_HOLE,
+  TEXTURE_COM_SCREEN,
+  TEXTURE_COUNT
+};
+const int NUM_OBJECT_TEXTURES = TEXTURE_OBJECT12 - TEXTURE_OBJECT1 + 1;
+
+class AssetLoader;
+class AssetPack;
 
 class TextureManager {
 public:
   static bool loadTextures(SDL_Renderer *renderer);
+  // Asynchronous form of loadTextures: queue the decodes, run the loader,
+  // then call finishTextures to build the atlas and name the sprites
+  static void queueTextures(SDL_Renderer *renderer, AssetLoader &loader);
+  static bool finishTextures();
   static bool loadFonts();
+  // Null until the texture has loaded
+  static SDL_Texture *getTexture(TextureId id) { return sprites[id].texture; }
+  static const Sprite *getSprite(TextureId id) {
+    return sprites[id].texture ? &sprites[id] : nullptr;
+  }
+  // Lookups by name, for tools and debugging rather than per-frame code
   static SDL_Texture *getTexture(const std::string &name);
+  static const Sprite *getSprite(const std::string &name);
   static TTF_Font *getFont(const std::string &name);
   static void freeTextures();
   static void freeFonts();
   static SDL_Texture *loadTexture(const std::string &path);
+  // Assets found in pack are used in place of the loose files under res/.
+  // The pack must stay open while textures and fonts are loaded.
+  static void setAssetPack(const AssetPack *pack);
 
 private:
+  // Images no larger than this on either side are packed into the atlas;
+  // full-screen backgrounds keep their own textures
+  static const int MAX_ATLAS_SPRITE_SIZE = 1024;
+  static const int MAX_ATLAS_SIZE = 4096;
+  // Transparent gap around each packed sprite so filtering can't bleed
+  static const int ATLAS_PADDING = 2;
+
+  struct PackedImage {
+    std::string path;
+    SDL_Surface *surface;
+    SDL_Rect rect;
+  };
+  static bool uploadSurface(const std::string &path, SDL_Surface *surface,
+                            const std::string &error);
+  static bool packAtlas(std::vector<PackedImage> &images);
+
   static SDL_Renderer *gRenderer;
-  static std::map<std::string, SDL_Texture *> textures;
+  static Sprite sprites[TEXTURE_COUNT];
+  static std::vector<SDL_Texture *> ownedTextures;
+  // Loading state between queueTextures and finishTextures, keyed by path
+  static std::map<std::string, Sprite> pathSprites;
+  static std::map<std::string, SDL_Surface *> pendingSurfaces;
   static std::map<std::string, TTF_Font *> fonts;
+  static const AssetPack *assetPack;
 };
 
 #endif
@@ -0,0 +1,163 @@
+#include "TrajectoryPreview.h"
+#include <algorithm>
+#include <cmath>
+
+// How far a ball launched with pressDuration rolls on open ground, stepped
+// the way updateBallPosition steps it at tickRate
+static float rollDistance(Uint32 pressDuration, int tickRate) {
+  const float ticks = static_cast<float>(REFERENCE_TICK_RATE) / tickRate;
+  const float friction = std::pow(FRICTION, ticks);
+  const float travel = (1.0f / friction - 1.0f) / -std::log(FRICTION);
+  float speed = std::min(pressDuration, MAX_PRESS_DURATION) / 5.0f;
+  float distance = 0.0f;
+  while (true) {
+    speed *= friction;
+    if (speed < 0.1f) {
+      return distance;
+    }
+    distance += speed * travel;
+  }
+}
+
+TrajectoryPreview::TrajectoryPreview()
+    : aimed(false), ballX(0), ballY(0), targetX(0), targetY(0), probe(),
+      bounces(0), finished(true), traced(0), length(0) {
+  dots.reserve(PREVIEW_MAX_DOTS);
+}
+
+void TrajectoryPreview::clear() {
+  aimed = false;
+  finished = true;
+  length = 0;
+  dots.clear();
+}
+
+void TrajectoryPreview::aim(const Ball &ball, int targetX, int targetY) {
+  if (aimed && ball.x == ballX && ball.y == ballY &&
+      targetX == this->targetX && targetY == this->targetY) {
+    return;
+  }
+  aimed = true;
+  ballX = ball.x;
+  ballY = ball.y;
+  this->targetX = targetX;
+  this->targetY = targetY;
+
+  // Same direction as launchBall's
+  float directionX = targetX - (ball.x + ball.w / 2);
+  float directionY = targetY - (ball.y + ball.h / 2);
+  float distance =
+      std::sqrt(directionX * directionX + directionY * directionY);
+  probe = ball;
+  probe.velX = distance ? -directionX / distance : 0.0f;
+  probe.velY = distance ? -directionY / distance : 0.0f;
+  bounces = 0;
+  finished = distance == 0;
+  traced = 0;
+  dots.clear();
+}
+
+void TrajectoryPreview::update(const Level &level, const SpatialGrid &grid,
+                               Uint32 pressDuration, int tickRate) {
+  if (!aimed) {
+    return;
+  }
+  length = rollDistance(pressDuration, tickRate);
+  for (int step = 0;
+       step < PREVIEW_STEPS_PER_UPDATE && !finished && traced < length;
+       ++step) {
+    traceStep(level, grid);
+  }
+}
+
+// Moves the probe PREVIEW_STEP_LENGTH along the path, resolving contacts as
+// updateBallPosition does
+void TrajectoryPreview::traceStep(const Level &level,
+                                  const SpatialGrid &grid) {
+  float remaining = 1.0f;
+  for (int contact = 0; contact < MAX_CONTACTS_PER_STEP && remaining > 0;
+       ++contact) {
+    float moveX = probe.velX * PREVIEW_STEP_LENGTH * remaining;
+    float moveY = probe.velY * PREVIEW_STEP_LENGTH * remaining;
+    SDL_Rect sweptBounds = {
+        static_cast<int>(std::floor(std::min(probe.x, probe.x + moveX))),
+        static_cast<int>(std::floor(std::min(probe.y, probe.y + moveY))),
+        static_cast<int>(std::ceil(std::fabs(moveX))) + probe.w + 1,
+        static_cast<int>(std::ceil(std::fabs(moveY))) + probe.h + 1};
+
+    float hitTime = 1.0f, normalX = 0, normalY = 0;
+    const SDL_Rect *hitObject = nullptr;
+    grid.query(sweptBounds, [&](int i) {
+      float time, nx, ny;
+      if (sweepBall(probe, moveX, moveY, level.objects[i], time, nx, ny) &&
+          (nx != 0 || ny != 0) && time < hitTime) {
+        hitTime = time;
+        normalX = nx;
+        normalY = ny;
+        hitObject = &level.objects[i];
+      }
+    });
+
+    // The path ends where the ball would drop
+    float holeTime, holeNormalX, holeNormalY;
+    if (sweepBall(probe, moveX, moveY, level.holeRect, holeTime, holeNormalX,
+                  holeNormalY) &&
+        (!hitObject || holeTime <= hitTime)) {
+      hitTime = holeTime;
+      hitObject = nullptr;
+      finished = true;
+    }
+
+    float fromX = probe.x, fromY = probe.y;
+    probe.x += moveX * hitTime;
+    probe.y += moveY * hitTime;
+    layDots(level.bounds, fromX, fromY);
+    if (finished || !hitObject) {
+      return;
+    }
+    if (bounces == PREVIEW_BOUNCES) {
+      finished = true;
+      return;
+    }
+    reflectBallOffObject(probe, *hitObject, normalX, normalY);
+    ++bounces;
+    remaining *= 1.0f - hitTime;
+  }
+  // Wedged between objects; the real ball would stall here too
+  if (remaining > 0) {
+    finished = true;
+  }
+}
+
+void TrajectoryPreview::layDots(const SDL_Rect &bounds, float fromX,
+                                float fromY) {
+  float moveX = probe.x - fromX, moveY = probe.y - fromY;
+  float move = std::sqrt(moveX * moveX + moveY * moveY);
+  for (float at = (dots.size() + 1) * PREVIEW_DOT_SPACING - traced;
+       at <= move; at += PREVIEW_DOT_SPACING) {
+    float x = fromX + moveX * (at / move);
+    float y = fromY + moveY * (at / move);
+    // Past the edge the ball would be put back on the course instead
+    if (x < bounds.x || x > bounds.x + bounds.w - BALL_SIZE ||
+        y < bounds.y || y > bounds.y + bounds.h - BALL_SIZE ||
+        dots.size() == PREVIEW_MAX_DOTS) {
+      finished = true;
+      break;
+    }
+    dots.push_back({x + probe.w / 2.0f, y + probe.h / 2.0f});
+  }
+  traced += move;
+}
+
+void TrajectoryPreview::draw(SpriteBatch &batch, const Sprite &dotSprite,
+                             const SDL_Rect &camera) const {
+  size_t shown = std::min(dots.size(),
+                          static_cast<size_t>(length / PREVIEW_DOT_SPACING));
+  for (size_t i = 0; i < shown; ++i) {
+    SDL_Rect rect = {
+        static_cast<int>(dots[i].x) - camera.x - PREVIEW_DOT_SIZE / 2,
+        static_cast<int>(dots[i].y) - camera.y - PREVIEW_DOT_SIZE / 2,
+        PREVIEW_DOT_SIZE, PREVIEW_DOT_SIZE};
+    batch.draw(dotSprite, rect);
+  }
+}
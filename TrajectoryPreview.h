@@ -0,0 +1,66 @@
+#ifndef TRAJECTORYPREVIEW_H
+#define TRAJECTORYPREVIEW_H
+
+#include "Level.h"
+#include "Physics.h"
+#include "SpatialGrid.h"
+#include "SpriteBatch.h"
+#include "TextureManager.h"
+#include <SDL.h>
+#include <vector>
+
+// Bounces the preview follows; it stops where the ball would hit next
+const int PREVIEW_BOUNCES = 3;
+// Distance between dots along the path, and their size
+const float PREVIEW_DOT_SPACING = 14.0f;
+const int PREVIEW_DOT_SIZE = 6;
+// Enough dots for the longest shot
+const int PREVIEW_MAX_DOTS = 96;
+// Most path traced in one update(), in steps of PREVIEW_STEP_LENGTH, so a
+// frame never spends more than a few dozen sweeps on it
+const int PREVIEW_STEPS_PER_UPDATE = 16;
+const float PREVIEW_STEP_LENGTH = 64.0f;
+
+// Dotted path a shot being aimed would take. Friction slows a ball without
+// turning it, so the path is the same line for every power and only its
+// length depends on how long the button has been held. The line is traced
+// once per aim, with the same sweeps updateBallPosition makes, and only
+// extended as the power grows; moving the pointer starts a new one. The
+// last dot falls within a spacing of where the ball would stop.
+class TrajectoryPreview {
+public:
+  TrajectoryPreview();
+
+  void clear();
+  bool empty() const { return !aimed; }
+
+  // Aims from ball, at rest, pulled towards (targetX, targetY) as with
+  // launchBall. Keeps what is traced if the shot's line hasn't changed.
+  void aim(const Ball &ball, int targetX, int targetY);
+  // Sets the length to how far a press of pressDuration rolls at tickRate
+  // and traces up to PREVIEW_STEPS_PER_UPDATE more steps of it
+  void update(const Level &level, const SpatialGrid &grid,
+              Uint32 pressDuration, int tickRate);
+  // Adds the dots up to the current length to batch
+  void draw(SpriteBatch &batch, const Sprite &dotSprite,
+            const SDL_Rect &camera) const;
+
+private:
+  void traceStep(const Level &level, const SpatialGrid &grid);
+  // Lays dots along the probe's move from (fromX, fromY)
+  void layDots(const SDL_Rect &bounds, float fromX, float fromY);
+
+  bool aimed;
+  float ballX, ballY;
+  int targetX, targetY;
+
+  // Ball moving along the path with a unit velocity
+  Ball probe;
+  int bounces;
+  bool finished; // Reached its last bounce, the hole or the edge
+  float traced;  // Path length traced so far
+  float length;  // Path length to show
+  std::vector<SDL_FPoint> dots; // Dot i is (i + 1) spacings along the path
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Hands the latest of a stream of values from one thread to another without
+// either ever waiting. The writer fills back() and publishes it; the reader
+// calls update() to switch to the newest published value and reads front().
+// Each side keeps a slot of its own and the third is swapped between them,
+// so the value being read is never written.
+template <typename T> class TripleBuffer {
+public:
+  TripleBuffer() : backIndex(0), frontIndex(1), middle(2) {}
+
+  // Writer side
+  T &back() { return slots[backIndex]; }
+  void publish() {
+    backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) &
+                INDEX_MASK;
+  }
+
+  // Reader side. Returns false, keeping the current front, if nothing new
+  // has been published since the last update.
+  bool update() {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+      return false;
+    }
+    frontIndex =
+        middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+  const T &front() const { return slots[frontIndex]; }
+
+private:
+  // The middle slot's index, with FRESH set while the reader hasn't taken it
+  static const unsigned INDEX_MASK = 3;
+  static const unsigned FRESH = 4;
+
+  T slots[3];
+  unsigned backIndex;
+  unsigned frontIndex;
+  std::atomic<unsigned> middle;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "WorkPool.h"
+#include <algorithm>
+
+WorkPool::WorkPool(unsigned threadCount)
+    : task(nullptr), remaining(0), batch(0), stopping(false) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned i = 0; i < threadCount; ++i) {
+    queues.emplace_back(new Queue);
+  }
+  // Queue 0 belongs to the thread calling parallelFor
+  for (unsigned i = 1; i < threadCount; ++i) {
+    workers.emplace_back(&WorkPool::work, this, i);
+  }
+}
+
+WorkPool::~WorkPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  batchReady.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void WorkPool::parallelFor(int count, const Task &newTask) {
+  if (count <= 0) {
+    return;
+  }
+
+  // Hand out contiguous ranges so neighbouring tasks share a thread until
+  // stealing breaks them up
+  task = &newTask;
+  remaining = count;
+  const int size = static_cast<int>(queues.size());
+  for (int q = 0; q < size; ++q) {
+    std::lock_guard<std::mutex> lock(queues[q]->mutex);
+    for (int i = count * q / size; i < count * (q + 1) / size; ++i) {
+      queues[q]->indices.push_back(i);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++batch;
+  }
+  batchReady.notify_all();
+
+  drain(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  batchDone.wait(lock, [this]() { return remaining == 0; });
+}
+
+void WorkPool::work(unsigned self) {
+  unsigned seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      batchReady.wait(lock, [&]() { return stopping || batch != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = batch;
+    }
+    drain(self);
+  }
+}
+
+void WorkPool::drain(unsigned self) {
+  int index;
+  while (pop(self, index) || steal(self, index)) {
+    // The task is read after taking an index: indices are only queued for
+    // the current batch, so the pair always matches
+    (*task.load())(index);
+    if (--remaining == 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      batchDone.notify_all();
+    }
+  }
+}
+
+bool WorkPool::pop(unsigned self, int &index) {
+  Queue &queue = *queues[self];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.indices.empty()) {
+    return false;
+  }
+  index = queue.indices.back();
+  queue.indices.pop_back();
+  return true;
+}
+
+bool WorkPool::steal(unsigned self, int &index) {
+  for (size_t offset = 1; offset < queues.size(); ++offset) {
+    Queue &queue = *queues[(self + offset) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.indices.empty()) {
+      index = queue.indices.front();
+      queue.indices.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
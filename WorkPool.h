@@ -0,0 +1,56 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for CPU-bound batches. Each batch is split over
+// per-thread queues; a thread runs its own queue from the back and, once it
+// is empty, steals from the front of the others, so uneven tasks still keep
+// every core busy.
+class WorkPool {
+public:
+  typedef std::function<void(int index)> Task;
+
+  // threadCount 0 uses one thread per hardware thread, counting the caller
+  explicit WorkPool(unsigned threadCount = 0);
+  ~WorkPool();
+
+  // Runs task(0) .. task(count - 1) across the pool and returns once all
+  // have finished. The calling thread works on the batch too. Not reentrant.
+  void parallelFor(int count, const Task &task);
+
+  // Threads working on a batch, including the caller
+  unsigned threadCount() const { return static_cast<unsigned>(queues.size()); }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<int> indices;
+  };
+
+  void work(unsigned self);
+  // Runs tasks from queue self, then stolen ones, until none are left
+  void drain(unsigned self);
+  bool pop(unsigned self, int &index);
+  bool steal(unsigned self, int &index);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<const Task *> task;
+  std::atomic<int> remaining;
+
+  std::mutex mutex;
+  std::condition_variable batchReady;
+  std::condition_variable batchDone;
+  unsigned batch;
+  bool stopping;
+};
+
+#endif
@@ -1,51 +1,126 @@
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "Audio.h"
+#include "Headless.h"
+#include "Level.h"
+#include "LevelGenerator.h"
+#include "LevelStreamer.h"
+#include "ParticleSystem.h"
+#include "Physics.h"
+#include "Profiler.h"
+#include "Render.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "Solver.h"
+#include "SpatialGrid.h"
+#include "SpriteBatch.h"
+#include "TextRenderer.h"
 #include "TextureManager.h"
+#include "TrajectoryPreview.h"
+#include "WorkPool.h"
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
 #include <SDL_ttf.h>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <memory>
 #include <stdlib.h>
-
-// Window dimensions
-const int SCREEN_WIDTH = 960;
-const int SCREEN_HEIGHT = 540;
-const int BALL_SIZE = 16;
-const int HOLE_SIZE = 16;
-const float BALL_SPEED = 5.0f;
-const float FRICTION = 0.9f;
-
-int bounceCount = 0.0;
-
-// Game states
-enum GameState { START_SCREEN, GAME_RUNNING, GAME_COMPLETED, GAME_EXIT };
+#include <string>
+#include <vector>
+
+// Physics tick rate and whether presents wait for vertical blank; both can be
+// changed from the command line
+int gTickRate = DEFAULT_TICK_RATE;
+bool gVsync = true;
+// Sample frames per audio buffer; smaller cuts latency, too small crackles
+int gAudioBuffer = DEFAULT_AUDIO_BUFFER;
+// Time a hint may search for before showing its best guess, within a frame
+const double HINT_BUDGET_SECONDS = 0.010;
+// Longest frame particles are moved on by, so they don't jump after a stall
+const double MAX_PARTICLE_STEP_SECONDS = 0.1;
 
 // Function prototypes
 bool init();
 void close();
-void handleEvents(SDL_Event &e, bool &quit, bool &moveBall, SDL_Rect &ballRect,
-                  float &ballVelX, float &ballVelY, bool &mousePressed,
-                  Uint32 &pressStartTime, bool &showArrow, SDL_Rect &arrowRect,
-                  float &arrowAngle, GameState &currentState);
-void updateBallPosition(SDL_Rect &ballRect, float &ballVelX, float &ballVelY,
-                        bool moveBall, const SDL_Rect objects[],
-                        size_t numObjects, GameState &currentState,
-                        const SDL_Rect &holeRect);
-void render(SDL_Texture *backgroundTexture, SDL_Texture *ballTexture,
-            SDL_Texture *arrowTexture, SDL_Texture *objectTextures[],
-            SDL_Texture *holeTexture, const SDL_Rect &ballRect,
-            const SDL_Rect &arrowRect, const SDL_Rect objects[],
-            const SDL_Rect &holeRect, bool &showArrow, float arrowAngle,
-            GameState &currentState, size_t numObjectTextures);
 void renderStartScreen(SDL_Texture *startScreenTexture);
 
 SDL_Window *gWindow = nullptr;
 SDL_Renderer *gRenderer = nullptr;
 Mix_Chunk *clickSound = nullptr;
 Mix_Chunk *holeSound = nullptr;
+SpriteBatch gSpriteBatch;
+AssetPack gAssetPack;
+std::string gAssetPackPath = DEFAULT_ASSET_PACK;
+// Seed of the current generated level; each new level takes the next one, so
+// `--seed` replays a session's courses
+uint64_t gLevelSeed = static_cast<uint64_t>(time(nullptr));
+// Screens each generated course spans; the view scrolls after the ball
+CourseSize gCourseSize = SINGLE_SCREEN;
+// Pushed by the simulation to wake the idle main loop
+Uint32 gWakeEvent = static_cast<Uint32>(-1);
+// Every session is recorded unless it is itself a replay
+ReplayWriter gReplayWriter;
+std::string gRecordPath = DEFAULT_REPLAY_PATH;
+std::string gReplayPath;
+
+void queueSound(AssetLoader &loader, const std::string &path,
+                Mix_Chunk *&sound) {
+  // Packed PCM is played straight from the mapping when it was decoded for
+  // the format the mixer is running in
+  const AssetPackEntry *entry =
+      gAssetPack.isOpen() ? gAssetPack.find(path) : nullptr;
+  int frequency = 0, channels = 0;
+  Uint16 format = 0;
+  Mix_QuerySpec(&frequency, &format, &channels);
+  if (entry && entry->type == ASSET_SOUND &&
+      static_cast<int>(entry->frequency) == frequency &&
+      entry->format == format && entry->channels == channels) {
+    sound = Mix_QuickLoad_RAW(const_cast<Uint8 *>(gAssetPack.data(*entry)),
+                              static_cast<Uint32>(entry->size));
+    if (sound) {
+      return;
+    }
+  }
+
+  loader.add([path, &sound]() -> AssetLoader::Finish {
+    Mix_Chunk *chunk = Mix_LoadWAV(path.c_str());
+    std::string error = chunk ? "" : Mix_GetError();
+    return [path, &sound, chunk, error]() {
+      if (!chunk) {
+        std::cerr << "Failed to load sound " << path << ": " << error
+                  << std::endl;
+        return false;
+      }
+      sound = chunk;
+      return true;
+    };
+  });
+}
+
+// Progress bar shown while assets load; also keeps the window responsive
+void renderLoadingScreen(int finished, int total) {
+  SDL_PumpEvents();
+
+  const int barWidth = 400, barHeight = 16;
+  SDL_Rect outline = {(SCREEN_WIDTH - barWidth) / 2,
+                      (SCREEN_HEIGHT - barHeight) / 2, barWidth, barHeight};
+  SDL_Rect fill = outline;
+  fill.w = total > 0 ? barWidth * finished / total : 0;
+
+  SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255);
+  SDL_RenderClear(gRenderer);
+  SDL_SetRenderDrawColor(gRenderer, 255, 255, 255, 255);
+  SDL_RenderFillRect(gRenderer, &fill);
+  SDL_RenderDrawRect(gRenderer, &outline);
+  SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255);
+  SDL_RenderPresent(gRenderer);
+}
 
 bool init() {
   // Initialize SDL, SDL_image, and SDL_ttf
@@ -63,8 +138,7 @@ bool init() {
     return false;
   }
 
-  if (Mix_OpenAudio(22050, MIX_DEFAULT_FORMAT, 2, 4096) == -1) {
-    std::cerr << "SDL_mixer open audio error: " << Mix_GetError() << std::endl;
+  if (!Audio::open(gAudioBuffer)) {
     return false;
   }
 
@@ -72,7 +146,11 @@ bool init() {
   gWindow = SDL_CreateWindow("Golf Pixel", SDL_WINDOWPOS_UNDEFINED,
                              SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH,
                              SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-  gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
+  Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+  if (gVsync) {
+    rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+  }
+  gRenderer = SDL_CreateRenderer(gWindow, -1, rendererFlags);
 
   if (!gWindow || !gRenderer) {
     std::cerr << "Window/Renderer creation error: " << SDL_GetError()
@@ -80,468 +158,367 @@ bool init() {
     return false;
   }
 
-  // Load textures and fonts
-  if (!TextureManager::loadTextures(gRenderer) ||
-      !TextureManager::loadFonts()) {
-    return false;
+  // A pre-baked pack replaces the loose files under res/ when present
+  if (gAssetPack.open(gAssetPackPath)) {
+    TextureManager::setAssetPack(&gAssetPack);
   }
 
-  // Load sound effects
-  clickSound = Mix_LoadWAV("res/ball_hit.mp3");
-  if (!clickSound) {
-    std::cerr << "Failed to load click sound: " << Mix_GetError() << std::endl;
-    return false;
-  }
-  holeSound = Mix_LoadWAV("res/hole_0.mp3");
-  if (!holeSound) {
-    std::cerr << "Failed to load click sound: " << Mix_GetError() << std::endl;
+  // Decode images and sounds on worker threads; each finished asset is
+  // uploaded here between frames of the loading screen
+  AssetLoader loader;
+  TextureManager::queueTextures(gRenderer, loader);
+  queueSound(loader, "res/ball_hit.mp3", clickSound);
+  queueSound(loader, "res/hole_0.mp3", holeSound);
+  bool assetsLoaded = loader.run(renderLoadingScreen);
+
+  // Load textures and fonts
+  if (!TextureManager::finishTextures() || !assetsLoaded ||
+      !TextureManager::loadFonts()) {
     return false;
   }
+  TextRenderer::init(gRenderer);
   return true;
 }
 
 void close() {
+  Audio::close();
   Mix_FreeChunk(clickSound);
   clickSound = nullptr;
   Mix_FreeChunk(holeSound);
   holeSound = nullptr;
   Mix_Quit();
+  TextRenderer::freeText();
+  freeStaticLayer();
   TextureManager::freeTextures();
   TextureManager::freeFonts();
   SDL_DestroyRenderer(gRenderer);
   SDL_DestroyWindow(gWindow);
+  TextureManager::setAssetPack(nullptr);
+  gAssetPack.close();
   TTF_Quit();
   IMG_Quit();
   SDL_Quit();
-  exit(0);
 }
 
-void randomizeObjectPositions(SDL_Rect objects[], size_t numObjects,
-                              SDL_Rect &ballRect, SDL_Rect &holeRect) {
-  const int minD = 100; // Minimum distance between screen boundaries
-  int BOUNDARY_WIDTH = 700;
-  int BOUNDARY_HEIGHT = 300;
-
-  srand(time(0));
-  // Helper function to check if two rectangles overlap
-  auto checkOverlap = [](const SDL_Rect &rect1, const SDL_Rect &rect2) {
-    return !(rect1.x + rect1.w <= rect2.x || rect1.y + rect1.h <= rect2.y ||
-             rect1.x >= rect2.x + rect2.w || rect1.y >= rect2.y + rect2.h);
-  };
-
-  // Randomize positions for objects
-  for (size_t i = 0; i < numObjects; ++i) {
-    bool positionFound = false;
-
-    while (!positionFound) {
-      // Random x and y positions within the screen boundaries
-      objects[i].x = minD + rand() % (BOUNDARY_WIDTH);
-      objects[i].y = minD + rand() % (BOUNDARY_HEIGHT);
-
-      // Check for overlap with other objects
-      bool overlap = false;
-      for (size_t j = 0; j < numObjects; ++j) {
-        if (i != j && checkOverlap(objects[i], objects[j])) {
-          overlap = true;
-          break;
-        }
-      }
-
-      // Ensure the position is not overlapping with any other objects
-      if (!overlap) {
-        positionFound = true;
-      }
-    }
-  }
-
-  // Randomize position for the ball
-  bool positionFound = false;
-  while (!positionFound) {
-    ballRect.x = minD + rand() % (BOUNDARY_WIDTH);
-    ballRect.y = minD + rand() % (BOUNDARY_HEIGHT);
-
-    // Check for overlap with other objects
-    bool overlap = false;
-    for (size_t j = 0; j < numObjects; ++j) {
-      if (checkOverlap(ballRect, objects[j])) {
-        overlap = true;
-        break;
-      }
-    }
+// Places the arrow beside the ball, pointing along (directionX, directionY)
+void aimArrow(const Ball &ball, float directionX, float directionY,
+              SDL_Rect &arrowRect, float &arrowAngle) {
+  arrowAngle = atan2f(directionY, directionX) * 180.0f / M_PI + 90;
+  float arrowDistance = BALL_SIZE * 1.7f;
+  arrowRect = {static_cast<int>(ball.x + (ball.w / 2) +
+                                (arrowDistance * directionX) - 25),
+               static_cast<int>(ball.y + (ball.h / 2) +
+                                (arrowDistance * directionY) - 25),
+               50, 50};
+}
 
-    // Ensure the position is not overlapping with any other objects
-    if (!overlap) {
-      positionFound = true;
-    }
+// Aims the arrow for a shot pulled towards (pointerX, pointerY); the ball
+// travels away from the pointer
+void aimArrowAt(const Ball &ball, int pointerX, int pointerY,
+                SDL_Rect &arrowRect, float &arrowAngle) {
+  float directionX = pointerX - (ball.x + ball.w / 2);
+  float directionY = pointerY - (ball.y + ball.h / 2);
+  float length = sqrt(directionX * directionX + directionY * directionY);
+
+  if (length) {
+    directionX /= length;
+    directionY /= length;
   }
 
-  // Randomize position for the hole
-  positionFound = false;
-  while (!positionFound) {
-    holeRect.x = minD + rand() % (BOUNDARY_WIDTH);
-    holeRect.y = minD + rand() % (BOUNDARY_HEIGHT);
-
-    // Check for overlap with other objects and ball
-    bool overlap = false;
-    for (size_t j = 0; j < numObjects; ++j) {
-      if (checkOverlap(holeRect, objects[j])) {
-        overlap = true;
-        break;
-      }
-    }
-    if (checkOverlap(holeRect, ballRect)) {
-      overlap = true;
-    }
-
-    // Ensure the position is not overlapping with any other objects or the ball
-    if (!overlap) {
-      positionFound = true;
-    }
-  }
+  aimArrow(ball, -directionX, -directionY, arrowRect, arrowAngle);
 }
 
-void handleEvents(SDL_Event &e, bool &quit, bool &moveBall, SDL_Rect &ballRect,
-                  float &ballVelX, float &ballVelY, bool &mousePressed,
+// camera is the view last drawn; the pointer is aimed through it
+void handleEvents(SDL_Event &e, bool &quit, Simulation &simulation,
+                  const SDL_Rect &camera, bool &mousePressed,
                   Uint32 &pressStartTime, bool &showArrow, SDL_Rect &arrowRect,
-                  float &arrowAngle, GameState &currentState,
-                  SDL_Rect objects[], size_t numObjects, SDL_Rect &holeRect) {
-  const Uint32 maxPressDuration = 400;
+                  float &arrowAngle, TrajectoryPreview &preview,
+                  WorkPool &pool, int &hintPower) {
+  // Input is judged against the world as last drawn; the simulation checks
+  // it again against the current one when it applies it
+  const WorldSnapshot &world = simulation.snapshot();
+  const Ball &ball = world.ball;
+  bool ballAtRest = ball.velX == 0 && ball.velY == 0;
 
   while (SDL_PollEvent(&e)) {
     if (e.type == SDL_QUIT) {
       quit = true;
-    } else if (currentState == START_SCREEN && e.type == SDL_KEYDOWN) {
-      currentState = GAME_RUNNING;
-    } else if (currentState == GAME_RUNNING) {
-      if (e.type == SDL_MOUSEBUTTONDOWN && ballVelX == 0 && ballVelY == 0) {
-        moveBall = true;
+    } else if (e.type == gWakeEvent) {
+      // Only wakes the loop to draw a new snapshot
+    } else if (e.type == SDL_RENDER_TARGETS_RESET) {
+      // Target contents are lost, so the static layer must be redrawn
+      invalidateStaticLayer();
+    } else if (e.type == SDL_KEYDOWN &&
+               Profiler::handleKey(e.key.keysym.sym)) {
+      // F3-F5 belong to the profiler in every state
+    } else if (e.type == SDL_KEYDOWN && world.state != START_SCREEN &&
+               gReplayPath.empty() && !mousePressed &&
+               (e.key.keysym.sym == SDLK_r || e.key.keysym.sym == SDLK_u)) {
+      // R rewinds a little and U takes back the last stroke, even after
+      // holing out
+      simulation.send({e.key.keysym.sym == SDLK_r ? INPUT_REWIND : INPUT_UNDO,
+                       0, 0, 0});
+      showArrow = false;
+      hintPower = 0;
+    } else if (world.state == START_SCREEN && e.type == SDL_KEYDOWN) {
+      simulation.send({INPUT_START, 0, 0, 0});
+    } else if (world.state == GAME_RUNNING && gReplayPath.empty()) {
+      // Shots are measured from the events' own timestamps and positions,
+      // taken when SDL queued them, so a slow frame between press and
+      // release neither adds power nor moves the aim
+      if (e.type == SDL_MOUSEBUTTONDOWN && ballAtRest) {
         mousePressed = true;
-        pressStartTime = SDL_GetTicks();
-
-        int mouseX, mouseY;
-        SDL_GetMouseState(&mouseX, &mouseY);
-
-        float directionX = mouseX - (ballRect.x + ballRect.w / 2);
-        float directionY = mouseY - (ballRect.y + ballRect.h / 2);
-        float length = sqrt(directionX * directionX + directionY * directionY);
-
-        if (length) {
-          directionX /= length;
-          directionY /= length;
-        }
-
-        arrowAngle = atan2f(directionY, directionX) * 180.0f / M_PI - 90;
-        float arrowDistance = BALL_SIZE * 1.7f;
-        arrowRect = {static_cast<int>(ballRect.x + (ballRect.w / 2) -
-                                      (arrowDistance * directionX) - 25),
-                     static_cast<int>(ballRect.y + (ballRect.h / 2) -
-                                      (arrowDistance * directionY) - 25),
-                     50, 50};
-
+        pressStartTime = e.button.timestamp;
+        aimArrowAt(ball, e.button.x + camera.x, e.button.y + camera.y,
+                   arrowRect, arrowAngle);
+        preview.aim(ball, e.button.x + camera.x, e.button.y + camera.y);
         showArrow = true;
-      } else if (e.type == SDL_MOUSEBUTTONUP && ballVelX == 0 &&
-                 ballVelY == 0) {
-        moveBall = false;
+        hintPower = 0;
+      } else if (e.type == SDL_MOUSEMOTION && mousePressed) {
+        // The arrow follows the pointer to show the shot a release makes
+        aimArrowAt(ball, e.motion.x + camera.x, e.motion.y + camera.y,
+                   arrowRect, arrowAngle);
+        preview.aim(ball, e.motion.x + camera.x, e.motion.y + camera.y);
+      } else if (e.type == SDL_MOUSEBUTTONUP && mousePressed) {
         mousePressed = false;
 
-        Uint32 pressDuration = SDL_GetTicks() - pressStartTime;
-        if (pressDuration > maxPressDuration) {
-          pressDuration = maxPressDuration;
-        }
-
-        int mouseX, mouseY;
-        SDL_GetMouseState(&mouseX, &mouseY);
-
-        float directionX = mouseX - (ballRect.x + ballRect.w / 2);
-        float directionY = mouseY - (ballRect.y + ballRect.h / 2);
-        float length = sqrt(directionX * directionX + directionY * directionY);
-
-        // Play the click sound effect
-        Mix_PlayChannel(-1, clickSound, 0);
-
-        if (length) {
-          directionX /= length;
-          directionY /= length;
-        }
-
-        ballVelX = -directionX * (pressDuration / 10.0f);
-        ballVelY = -directionY * (pressDuration / 10.0f);
-
+        Uint32 pressDuration = e.button.timestamp - pressStartTime;
+        simulation.send({INPUT_SHOT, e.button.x + camera.x,
+                         e.button.y + camera.y, pressDuration});
         showArrow = false;
+        preview.clear();
+      } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_h &&
+                 !mousePressed && ballAtRest) {
+        // Show the first stroke of the best line the solver finds in the
+        // budget, or of the one that gets closest if none holes the ball
+        SolverOptions options;
+        options.budgetSeconds = HINT_BUDGET_SECONDS;
+        options.anySolution = true;
+        SolverResult result = solveLevel(world.course->level,
+                                         world.course->grid, ball, pool,
+                                         options);
+        const Solution &line = result.fewestStrokes.shots.empty()
+                                   ? result.nearest
+                                   : result.fewestStrokes;
+        if (!line.shots.empty()) {
+          const Shot &shot = line.shots.front();
+          // Solver shots aim at the point pulled towards, opposite the
+          // direction of travel
+          aimArrow(ball, -static_cast<float>(shot.aimX) / SOLVER_AIM_RADIUS,
+                   -static_cast<float>(shot.aimY) / SOLVER_AIM_RADIUS,
+                   arrowRect, arrowAngle);
+          showArrow = true;
+          hintPower = shot.pressDuration * 100 / MAX_PRESS_DURATION;
+        }
       }
-    } else if (currentState == GAME_COMPLETED &&
-               e.key.keysym.sym == SDLK_RETURN) {
-
-      // Reset the ball position and velocity
-      ballRect = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, BALL_SIZE, BALL_SIZE};
-      ballVelX = ballVelY = 0;
-
-      // Randomize object positions including ball and hole
-      randomizeObjectPositions(objects, numObjects, ballRect, holeRect);
-
-      // Reset bounce count
-      bounceCount = 0.0;
-
+    } else if (world.state == GAME_COMPLETED && gReplayPath.empty() &&
+               e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_RETURN) {
       // Next level
-      currentState = GameState::GAME_RUNNING;
-    } else if (e.key.keysym.sym == SDLK_ESCAPE) {
-      close();
+      simulation.send({INPUT_NEXT_LEVEL, 0, 0, 0});
+      showArrow = false;
+      hintPower = 0;
+    } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
+      quit = true;
     }
   }
 }
 
-void reflectBallOffObject(SDL_Rect &ballRect, float &ballVelX, float &ballVelY,
-                          const SDL_Rect &objectRect) {
-  int deltaX =
-      (ballRect.x + ballRect.w / 2) - (objectRect.x + objectRect.w / 2);
-  int deltaY =
-      (ballRect.y + ballRect.h / 2) - (objectRect.y + objectRect.h / 2);
-
-  if (std::abs(deltaX) > std::abs(deltaY)) {
-    if (deltaX > 0) {
-      // Ball is on the right side of the object
-      ballRect.x =
-          objectRect.x + objectRect.w; // Move ball to the right of the object
-    } else {
-      // Ball is on the left side of the object
-      ballRect.x =
-          objectRect.x - ballRect.w; // Move ball to the left of the object
-    }
-    ballVelX = -ballVelX;
-  } else {
-    if (deltaY > 0) {
-      // Ball is below the object
-      ballRect.y = objectRect.y + objectRect.h; // Move ball below the object
-    } else {
-      // Ball is above the object
-      ballRect.y = objectRect.y - ballRect.h; // Move ball above the object
-    }
-    ballVelY = -ballVelY;
-  }
+void renderStartScreen(SDL_Texture *startScreenTexture) {
+  SDL_RenderCopy(gRenderer, startScreenTexture, nullptr, nullptr);
 }
 
-bool checkCollision(SDL_Rect &ballRect, const SDL_Rect &objectRect) {
-  return SDL_HasIntersection(&ballRect, &objectRect);
-}
-void updateBallPosition(SDL_Rect &ballRect, float &ballVelX, float &ballVelY,
-                        bool moveBall, const SDL_Rect objects[],
-                        size_t numObjects, GameState &currentState,
-                        const SDL_Rect &holeRect, bool &ballInHole,
-                        float &animationProgress) {
-
-  if (ballInHole) {
-    // Animate the ball falling into the hole
-    animationProgress += 0.05f; // Adjust speed of animation
-    if (ballRect.w >= 12) {
-      // Ball falls and shrinks
-      ballRect.w = static_cast<float>(
-          BALL_SIZE * (0.8f - animationProgress)); // Shrink width
-      ballRect.h = static_cast<float>(
-          BALL_SIZE * (0.8f - animationProgress)); // Shrink height
-    } else {
-      SDL_Delay(1000);
-      currentState = GameState::GAME_COMPLETED;
-      ballInHole = false;
+int main(int argc, char *args[]) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = args[i];
+    if (arg == "--headless") {
+      // Physics-only run for build boxes without a display or sound device
+      return runHeadless(argc, args);
+    } else if (arg == "--generate") {
+      return runLevelBatch(argc, args);
+    } else if (arg == "--ball-bench") {
+      return runBallBenchmark(argc, args);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      gLevelSeed = std::strtoull(args[++i], nullptr, 10);
+    } else if (arg == "--course" && i + 1 < argc) {
+      // COLUMNSxROWS screens
+      CourseSize size = SINGLE_SCREEN;
+      if (std::sscanf(args[++i], "%dx%d", &size.columns, &size.rows) == 2 &&
+          size.columns > 0 && size.rows > 0) {
+        gCourseSize = size;
+      }
+    } else if (arg == "--tick-rate" && i + 1 < argc) {
+      gTickRate = std::max(1, std::atoi(args[++i]));
+    } else if (arg == "--no-vsync") {
+      gVsync = false;
+    } else if (arg == "--audio-buffer" && i + 1 < argc) {
+      gAudioBuffer = std::max(32, std::atoi(args[++i]));
+    } else if (arg == "--pack" && i + 1 < argc) {
+      gAssetPackPath = args[++i];
+    } else if (arg == "--record" && i + 1 < argc) {
+      gRecordPath = args[++i];
+    } else if (arg == "--replay" && i + 1 < argc) {
+      gReplayPath = args[++i];
     }
-
-    return;
   }
 
-  if (!moveBall) {
-    ballVelX *= FRICTION;
-    ballVelY *= FRICTION;
-    if (std::fabs(ballVelX) < 0.1f)
-      ballVelX = 0;
-    if (std::fabs(ballVelY) < 0.1f)
-      ballVelY = 0;
+  // A replay runs at the tick rate it was recorded at, since physics only
+  // repeats exactly at the same rate
+  Replay replay;
+  if (!gReplayPath.empty()) {
+    if (!loadReplay(gReplayPath, replay)) {
+      return 1;
+    }
+    gTickRate = replay.tickRate;
+    gCourseSize = replay.courseSize;
   }
 
-  ballRect.x += static_cast<int>(ballVelX);
-  ballRect.y += static_cast<int>(ballVelY);
+  if (!init())
+    return 1;
 
-  if (ballRect.x < 0 || ballRect.x > SCREEN_WIDTH - BALL_SIZE ||
-      ballRect.y < 0 || ballRect.y > SCREEN_HEIGHT - BALL_SIZE) {
-    ballRect = {3 * SCREEN_WIDTH / 4, 3 * SCREEN_HEIGHT / 4, BALL_SIZE,
-                BALL_SIZE};
-    ballVelX = ballVelY = 0;
+  if (gReplayPath.empty() &&
+      gReplayWriter.open(gRecordPath, gTickRate, gCourseSize)) {
+    gReplayWriter.level(0, 0);
   }
 
-  float newX = ballRect.x + ballVelX;
-  float newY = ballRect.y + ballVelY;
-
-  SDL_Rect futureBallRect = {static_cast<int>(newX), static_cast<int>(newY),
-                             ballRect.w, ballRect.h};
-
-  // Check if the ball falls into the hole
-  if (checkCollision(futureBallRect, holeRect)) {
-    ballRect.x = holeRect.x + holeRect.w / 4;
-    ballRect.y = holeRect.y + holeRect.h / 4;
-
-    ballInHole = true;
-    ballVelX = ballVelY = 0;
-    Mix_PlayChannel(-1, holeSound, 0);
-    animationProgress = 0.0f; // Reset animation progress
-    return;                   // Exit the function to start animation
+  // Physics runs on its own thread at gTickRate; this one handles input and
+  // draws the newest snapshot as fast as vsync (or the machine) allows
+  gWakeEvent = SDL_RegisterEvents(1);
+  LevelStreamer streamer(gCourseSize);
+  Simulation simulation(streamer, gReplayWriter,
+                        gReplayPath.empty() ? nullptr : &replay, clickSound,
+                        holeSound, gTickRate, gLevelSeed, gWakeEvent);
+  if (!simulation.start()) {
+    close();
+    return 1;
   }
 
-  // Use a standard for loop to iterate over the objects array
-  for (size_t i = 0; i < numObjects; ++i) {
-    if (checkCollision(futureBallRect, objects[i])) {
-      reflectBallOffObject(ballRect, ballVelX, ballVelY, objects[i]);
-      bounceCount++; // Increment bounce count on collision
-      return;        // Stop further checks once a collision is handled
-    }
+  bool quit = false, mousePressed = false, showArrow = false;
+  Uint32 pressStartTime = 0;
+  SDL_Event e;
+  SDL_Rect arrowRect = {0, 0, 50, 50};
+  float arrowAngle = 0.0f;
+  WorkPool solverPool;
+  int hintPower = 0;
+  // Keeps the course the static layer was drawn from alive, so a new one
+  // can't reuse its address unnoticed
+  std::shared_ptr<const Course> drawnCourse;
+  SDL_Rect camera = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+  ParticleSystem particles;
+  TrajectoryPreview preview;
+  std::chrono::steady_clock::time_point lastFrame =
+      std::chrono::steady_clock::now();
+
+  const Sprite *objectSprites[NUM_OBJECT_TEXTURES];
+  for (int i = 0; i < NUM_OBJECT_TEXTURES; ++i) {
+    objectSprites[i] =
+        TextureManager::getSprite(static_cast<TextureId>(TEXTURE_OBJECT1 + i));
   }
 
-  // Update ball position if no collision
-  ballRect.x = newX;
-  ballRect.y = newY;
-}
-
-void render(SDL_Texture *startScreenTexture, SDL_Texture *backgroundTexture,
-            SDL_Texture *ballTexture, SDL_Texture *arrowTexture,
-            SDL_Texture *objectTextures[], SDL_Texture *holeTexture,
-            const SDL_Rect &ballRect, const SDL_Rect &arrowRect,
-            const SDL_Rect objects[], const SDL_Rect &holeRect, bool showArrow,
-            float arrowAngle, GameState currentState, size_t numObjectTextures,
-            SDL_Texture *flashScreenTexture) {
-  SDL_RenderClear(gRenderer);
+  const double tickSeconds = 1.0 / gTickRate;
 
-  if (currentState == START_SCREEN) {
-    if (startScreenTexture) {
-      SDL_RenderCopy(gRenderer, startScreenTexture, nullptr, nullptr);
-    } else {
-      std::cerr << "Failed to load start screen texture." << std::endl;
-    }
-  } else if (currentState == GAME_RUNNING) {
-    if (backgroundTexture) {
-      SDL_RenderCopy(gRenderer, backgroundTexture, nullptr, nullptr);
-    }
-    for (size_t i = 0; i < numObjectTextures; ++i) {
-      if (objectTextures[i]) {
-        SDL_RenderCopy(gRenderer, objectTextures[i], nullptr, &objects[i]);
+  while (!quit) {
+    Profiler::beginFrame();
+    // With nothing moving, frames would only repeat themselves, so sleep
+    // until there's input or the simulation publishes something new. A
+    // held button keeps frames coming until the shot reaches full power.
+    // The sleep counts towards the frame it wakes for; one that times out
+    // starts the frame over.
+    bool powerGrowing =
+        mousePressed && SDL_GetTicks() - pressStartTime <= MAX_PRESS_DURATION;
+    if (!simulation.updateSnapshot() && simulation.snapshot().idle &&
+        particles.empty() && !powerGrowing) {
+      bool woken;
+      {
+        ProfileScope scope(PROFILE_SLEEP);
+        woken = SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+      }
+      if (!woken) {
+        continue;
       }
     }
-    if (holeTexture) {
-      SDL_RenderCopy(gRenderer, holeTexture, nullptr, &holeRect);
+
+    {
+      ProfileScope scope(PROFILE_EVENTS);
+      handleEvents(e, quit, simulation, camera, mousePressed, pressStartTime,
+                   showArrow, arrowRect, arrowAngle, preview, solverPool,
+                   hintPower);
     }
-    if (ballTexture) {
-      SDL_RenderCopy(gRenderer, ballTexture, nullptr, &ballRect);
+    simulation.updateSnapshot();
+    const WorldSnapshot &world = simulation.snapshot();
+    const Course &course = *world.course;
+    if (world.course != drawnCourse) {
+      invalidateStaticLayer();
+      particles.clear();
+      preview.clear();
+      drawnCourse = world.course;
     }
-    if (showArrow && arrowTexture) {
-      SDL_RenderCopyEx(gRenderer, arrowTexture, nullptr, &arrowRect, arrowAngle,
-                       nullptr, SDL_FLIP_NONE);
+    if (mousePressed) {
+      ProfileScope scope(PROFILE_PREVIEW);
+      // Power grows for as long as the button is held, and the path with it
+      preview.update(course.level, course.grid,
+                     SDL_GetTicks() - pressStartTime, gTickRate);
     }
 
-    // Render the bounce count
-    TTF_Font *font = TextureManager::getFont("font"); // Ensure 'font' is loaded
-    if (font) {
-      SDL_Color textColor = {255, 255, 255, 255}; // White color
-      std::string bounceText = "Bounce #" + std::to_string(bounceCount);
-
-      // Create surface from text
-      SDL_Surface *textSurface =
-          TTF_RenderText_Solid(font, bounceText.c_str(), textColor);
-      if (textSurface) {
-        // Create texture from surface
-        SDL_Texture *textTexture =
-            SDL_CreateTextureFromSurface(gRenderer, textSurface);
-        SDL_FreeSurface(textSurface); // Free the surface
-
-        // Get text texture dimensions
-        int textWidth = 0, textHeight = 0;
-        SDL_QueryTexture(textTexture, nullptr, nullptr, &textWidth,
-                         &textHeight);
-
-        // Set text position (top-left corner)
-        SDL_Rect textRect = {40, 30, textWidth, textHeight};
-
-        // Render the text
-        SDL_RenderCopy(gRenderer, textTexture, nullptr, &textRect);
-
-        // Clean up
-        SDL_DestroyTexture(textTexture);
+    // Draw the ball between the last two ticks, as far along as the time
+    // since the last one
+    std::chrono::duration<double> sinceTick =
+        std::chrono::steady_clock::now() - world.time;
+    float alpha = static_cast<float>(
+        std::min(1.0, std::max(0.0, sinceTick.count() / tickSeconds)));
+    SDL_Rect ballRect =
+        interpolateBallRect(world.previousBall, world.ball, alpha);
+    camera = followCamera(ballRect, course.level.bounds);
+
+    {
+      ProfileScope scope(PROFILE_PARTICLES);
+      // Particles run on frame time rather than ticks; they're only for show
+      std::chrono::steady_clock::time_point now =
+          std::chrono::steady_clock::now();
+      std::chrono::duration<double> frameTime = now - lastFrame;
+      lastFrame = now;
+
+      Effect effect;
+      while (simulation.pollEffect(effect)) {
+        if (effect.type == EFFECT_BOUNCE) {
+          particles.dust(effect.x, effect.y, effect.strength);
+        } else if (effect.type == EFFECT_HOLE) {
+          particles.confetti(effect.x, effect.y);
+        } else {
+          // Don't join the trail across the jump
+          particles.endTrail();
+        }
+      }
+      if (world.state == GAME_RUNNING &&
+          (world.ball.velX != 0 || world.ball.velY != 0)) {
+        particles.trail(ballRect.x + ballRect.w / 2.0f,
+                        ballRect.y + ballRect.h / 2.0f);
       } else {
-        std::cerr << "Unable to render text surface! SDL_ttf Error: "
-                  << TTF_GetError() << std::endl;
+        particles.endTrail();
       }
-    } else {
-      std::cerr << "Font not loaded." << std::endl;
-    }
-  } else if (currentState == GAME_COMPLETED) {
-    if (flashScreenTexture) {
-      SDL_RenderCopy(gRenderer, flashScreenTexture, nullptr, nullptr);
-    } else {
-      std::cerr << "Failed to load flash screen texture." << std::endl;
+      particles.update(static_cast<float>(
+          std::min(frameTime.count(), MAX_PARTICLE_STEP_SECONDS)));
     }
-  }
-
-  SDL_RenderPresent(gRenderer);
-}
-
-void renderStartScreen(SDL_Texture *startScreenTexture) {
-  SDL_RenderCopy(gRenderer, startScreenTexture, nullptr, nullptr);
-}
-
-int main(int argc, char *args[]) {
-  if (!init())
-    return 1;
 
-  SDL_Rect ballRect = {SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, BALL_SIZE,
-                       BALL_SIZE};
-  float ballVelX = 0, ballVelY = 0;
-  bool quit = false, moveBall = false, mousePressed = false, showArrow = false;
-  Uint32 pressStartTime = 0;
-  SDL_Event e;
-  SDL_Rect arrowRect = {0, 0, 50, 50};
-  float arrowAngle = 0.0f;
-  SDL_Rect objects[12] = {
-      {300, 200, 70, 40}, {350, 100, 80, 45}, {600, 450, 100, 60},
-      {600, 200, 50, 50}, {250, 250, 55, 55}, {300, 400, 50, 50},
-      {800, 310, 95, 95}, {750, 100, 95, 95}, {480, 410, 50, 50},
-      {150, 180, 80, 45}, {480, 160, 40, 40}, {100, 400, 100, 100},
-  };
-  SDL_Rect holeRect = {90, 280, HOLE_SIZE, HOLE_SIZE};
-  bool ballInHole = false; // Declare a bool variable
-  float animationProgress = 0.0f;
-
-  SDL_Texture *objectTextures[12] = {TextureManager::getTexture("object1"),
-                                     TextureManager::getTexture("object2"),
-                                     TextureManager::getTexture("object3"),
-                                     TextureManager::getTexture("object4"),
-                                     TextureManager::getTexture("object5"),
-                                     TextureManager::getTexture("object6"),
-                                     TextureManager::getTexture("object7"),
-                                     TextureManager::getTexture("object8"),
-                                     TextureManager::getTexture("object9"),
-                                     TextureManager::getTexture("object10"),
-                                     TextureManager::getTexture("object11"),
-                                     TextureManager::getTexture("object12")};
-
-  GameState currentState = START_SCREEN;
-  srand(static_cast<unsigned int>(time(nullptr)));
-
-  while (!quit) {
-    handleEvents(e, quit, moveBall, ballRect, ballVelX, ballVelY, mousePressed,
-                 pressStartTime, showArrow, arrowRect, arrowAngle, currentState,
-                 objects, std::size(objects), holeRect);
-
-    if (currentState == GAME_RUNNING) {
-      updateBallPosition(ballRect, ballVelX, ballVelY, moveBall, objects,
-                         std::size(objects), currentState, holeRect, ballInHole,
-                         animationProgress);
-    }
-    render(TextureManager::getTexture("startScreen"),
-           TextureManager::getTexture("background"),
-           TextureManager::getTexture("ball"),
-           TextureManager::getTexture("arrow"), objectTextures,
-           TextureManager::getTexture("hole"), ballRect, arrowRect, objects,
-           holeRect, showArrow, arrowAngle, currentState,
-           std::size(objectTextures), TextureManager::getTexture("comScreen"));
-
-    SDL_Delay(16); // Approximately 60 FPS
+    render(gRenderer, gSpriteBatch,
+           TextureManager::getTexture(TEXTURE_START_SCREEN),
+           TextureManager::getTexture(TEXTURE_BACKGROUND),
+           TextureManager::getSprite(TEXTURE_BALL),
+           TextureManager::getSprite(TEXTURE_ARROW), objectSprites,
+           TextureManager::getSprite(TEXTURE_HOLE),
+           ballRect, arrowRect, course.level.objects.data(), course.grid,
+           course.level.holeRect, camera, particles, preview, showArrow,
+           arrowAngle,
+           world.state,
+           std::size(objectSprites),
+           TextureManager::getTexture(TEXTURE_COM_SCREEN), world.bounces,
+           world.par, hintPower, world.fade);
+    Profiler::endFrame();
   }
 
+  // Stop the simulation before the sounds it plays are freed. The solver
+  // pool and the streamer join their threads as main returns, before any
+  // static is destroyed.
+  simulation.stop();
   close();
   return 0;
 }
@@ -0,0 +1,416 @@
+// Benchmark suite for the game's hot paths, runnable on a machine without a
+// display or GPU: rendering goes through SDL's software renderer.
+//
+//   benchmark [--samples N] [--filter TEXT] [--baseline FILE]
+//             [--save-baseline FILE] [--tolerance PCT]
+//
+// Each benchmark runs one warm-up pass and then N timed samples of a fixed
+// workload. The median is reported alongside the fastest sample and the
+// interquartile spread. With --baseline, any median more than PCT percent
+// (default 15) slower than the baseline's fails the run. Run from the
+// repository root.
+#include "../Headless.h"
+#include "../Level.h"
+#include "../LevelGenerator.h"
+#include "../ParticleSystem.h"
+#include "../Physics.h"
+#include "../Render.h"
+#include "../Solver.h"
+#include "../SpatialGrid.h"
+#include "../SpriteBatch.h"
+#include "../TextRenderer.h"
+#include "../TextureManager.h"
+#include "../TrajectoryPreview.h"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+static const int DEFAULT_SAMPLES = 9;
+static const double DEFAULT_TOLERANCE = 15.0;
+// Fixed workloads; changing one invalidates saved baselines
+static const int TRAJECTORY_SHOTS = 256;
+static const int GENERATED_LEVELS = 64;
+static const int RENDERED_FRAMES = 120;
+static const CourseSize SCROLLING_COURSE = {10, 10};
+static const int PARTICLE_FRAMES = 120;
+// Frame length while a shot is held, for the preview's power ramp
+static const Uint32 FRAME_MILLISECONDS = 16;
+
+struct Benchmark {
+  std::string name;
+  // Runs the workload once and returns how many items it processed, or -1
+  // if it could not run
+  std::function<long()> run;
+};
+
+struct Measurement {
+  double median, fastest, spread; // milliseconds per sample
+  long items;
+};
+
+static void printUsage() {
+  std::cerr << "Usage: benchmark [--samples N] [--filter TEXT] "
+               "[--baseline FILE] [--save-baseline FILE] [--tolerance PCT]"
+            << std::endl;
+}
+
+static bool measure(const Benchmark &benchmark, int samples,
+                    Measurement &result) {
+  // Warm caches, the allocator and any lazily built state first
+  result.items = benchmark.run();
+  if (result.items < 0) {
+    return false;
+  }
+
+  std::vector<double> times;
+  for (int i = 0; i < samples; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    benchmark.run();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    times.push_back(elapsed.count());
+  }
+  std::sort(times.begin(), times.end());
+  result.median = times[times.size() / 2];
+  result.fastest = times.front();
+  result.spread = times[times.size() * 3 / 4] - times[times.size() / 4];
+  return true;
+}
+
+// Baseline files hold one "NAME MEDIAN_MS" line per benchmark
+static bool loadBaseline(const std::string &path,
+                         std::map<std::string, double> &baseline) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Unable to open baseline " << path << std::endl;
+    return false;
+  }
+  std::string name;
+  double median;
+  while (file >> name >> median) {
+    baseline[name] = median;
+  }
+  return true;
+}
+
+static bool saveBaseline(const std::string &path,
+                         const std::map<std::string, double> &medians) {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Unable to write baseline " << path << std::endl;
+    return false;
+  }
+  for (const auto &pair : medians) {
+    file << pair.first << " " << pair.second << "\n";
+  }
+  return static_cast<bool>(file);
+}
+
+// A fan of strokes from the built-in course's start, every direction at
+// several powers, played through updateBallPosition at the default tick rate
+static long runTrajectories(const Level &level, const SpatialGrid &grid) {
+  long ticks = 0;
+  for (int i = 0; i < TRAJECTORY_SHOTS; ++i) {
+    float angle = (i / 8) * 2.39996323f;
+    int targetX = level.ballRect.x + BALL_SIZE / 2 +
+                  static_cast<int>(std::cos(angle) * SOLVER_AIM_RADIUS);
+    int targetY = level.ballRect.y + BALL_SIZE / 2 +
+                  static_cast<int>(std::sin(angle) * SOLVER_AIM_RADIUS);
+    Uint32 pressDuration = MAX_PRESS_DURATION * (i % 8 + 1) / 8;
+
+    Ball ball;
+    placeBall(ball, level.ballRect);
+    ticks += simulateShot(level, grid, ball, targetX, targetY, pressDuration,
+                          DEFAULT_TICK_RATE)
+                 .ticks;
+  }
+  return ticks;
+}
+
+// Aims the trajectory preview along the same fan of strokes as
+// runTrajectories and holds each for as many frames as full power takes,
+// updating the path every frame as the game does while aiming. The fan
+// aims each way eight times; the repeats reuse the path already traced.
+static long runPreview(const Level &level, const SpatialGrid &grid) {
+  TrajectoryPreview preview;
+  long updates = 0;
+  for (int i = 0; i < TRAJECTORY_SHOTS; ++i) {
+    float angle = (i / 8) * 2.39996323f;
+    int targetX = level.ballRect.x + BALL_SIZE / 2 +
+                  static_cast<int>(std::cos(angle) * SOLVER_AIM_RADIUS);
+    int targetY = level.ballRect.y + BALL_SIZE / 2 +
+                  static_cast<int>(std::sin(angle) * SOLVER_AIM_RADIUS);
+
+    Ball ball;
+    placeBall(ball, level.ballRect);
+    preview.aim(ball, targetX, targetY);
+    for (Uint32 held = 0; held <= MAX_PRESS_DURATION;
+         held += FRAME_MILLISECONDS) {
+      preview.update(level, grid, held, DEFAULT_TICK_RATE);
+      ++updates;
+    }
+  }
+  return updates;
+}
+
+// Generates GENERATED_LEVELS layouts from fixed seeds with objectCount
+// obstacles. Beyond the built-in course's twelve, obstacles are smaller so
+// they still fit the generation area.
+static long runGeneration(size_t objectCount) {
+  Level level = defaultLevel();
+  std::vector<SDL_Rect> sizes = level.objects;
+  level.objects.resize(objectCount);
+  for (size_t i = 0; i < objectCount; ++i) {
+    level.objects[i] =
+        objectCount <= sizes.size() ? sizes[i] : SDL_Rect{0, 0, 40, 40};
+  }
+
+  long generated = 0;
+  for (int seed = 1; seed <= GENERATED_LEVELS; ++seed) {
+    generated += generateLevel(seed, level);
+  }
+  return generated;
+}
+
+// Software renderer and assets for the texture and render benchmarks
+struct RenderTarget {
+  SDL_Surface *surface = nullptr;
+  SDL_Renderer *renderer = nullptr;
+};
+
+static bool initRendering(RenderTarget &target) {
+  // Nothing here opens a window, but keep SDL off any real display anyway
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+  if (SDL_Init(SDL_INIT_VIDEO) < 0 || !IMG_Init(IMG_INIT_PNG) ||
+      TTF_Init() == -1) {
+    std::cerr << "SDL initialization error: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  target.surface = SDL_CreateRGBSurfaceWithFormat(
+      0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+  target.renderer =
+      target.surface ? SDL_CreateSoftwareRenderer(target.surface) : nullptr;
+  if (!target.renderer) {
+    std::cerr << "Software renderer error: " << SDL_GetError() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static void closeRendering(RenderTarget &target) {
+  TextRenderer::freeText();
+  freeStaticLayer();
+  TextureManager::freeTextures();
+  TextureManager::freeFonts();
+  if (target.renderer) {
+    SDL_DestroyRenderer(target.renderer);
+  }
+  if (target.surface) {
+    SDL_FreeSurface(target.surface);
+  }
+  TTF_Quit();
+  IMG_Quit();
+  SDL_Quit();
+}
+
+// Frees every texture and loads them all again from the loose files
+static long runTextureLoad(SDL_Renderer *renderer) {
+  TextureManager::freeTextures();
+  return TextureManager::loadTextures(renderer) ? 1 : -1;
+}
+
+// Draws RENDERED_FRAMES game frames of level with the ball moving across it
+// by (stepX, stepY) a frame, the camera following it and the aim arrow
+// showing. The static layer starts empty, as on a level's first frame.
+static long runFrames(SDL_Renderer *renderer, SpriteBatch &batch,
+                      const Level &level, const SpatialGrid &grid, int stepX,
+                      int stepY) {
+  ParticleSystem particles;
+  TrajectoryPreview preview;
+  const Sprite *objectSprites[NUM_OBJECT_TEXTURES];
+  for (int i = 0; i < NUM_OBJECT_TEXTURES; ++i) {
+    objectSprites[i] =
+        TextureManager::getSprite(static_cast<TextureId>(TEXTURE_OBJECT1 + i));
+  }
+  const Sprite *ballSprite = TextureManager::getSprite(TEXTURE_BALL);
+  const Sprite *arrowSprite = TextureManager::getSprite(TEXTURE_ARROW);
+  const Sprite *holeSprite = TextureManager::getSprite(TEXTURE_HOLE);
+  SDL_Texture *startScreen = TextureManager::getTexture(TEXTURE_START_SCREEN);
+  SDL_Texture *background = TextureManager::getTexture(TEXTURE_BACKGROUND);
+  SDL_Texture *comScreen = TextureManager::getTexture(TEXTURE_COM_SCREEN);
+  if (!ballSprite || !arrowSprite || !holeSprite || !background) {
+    return -1;
+  }
+
+  invalidateStaticLayer();
+  for (int frame = 0; frame < RENDERED_FRAMES; ++frame) {
+    SDL_Rect ballRect = level.ballRect;
+    ballRect.x = (ballRect.x + frame * stepX) % level.bounds.w;
+    ballRect.y = (ballRect.y + frame * stepY) % level.bounds.h;
+    SDL_Rect arrowRect = {ballRect.x - 20, ballRect.y - 20, 56, 56};
+    render(renderer, batch, startScreen, background, ballSprite, arrowSprite,
+           objectSprites, holeSprite, ballRect, arrowRect,
+           level.objects.data(), grid, level.holeRect,
+           followCamera(ballRect, level.bounds), particles, preview, true,
+           frame * 3.0f,
+           GAME_RUNNING, NUM_OBJECT_TEXTURES, comScreen, frame / 10,
+           level.par, 0, 0.0f);
+  }
+  return RENDERED_FRAMES;
+}
+
+// Updates and draws PARTICLE_FRAMES frames of particles kept near
+// MAX_PARTICLES live: bursts of dust and confetti as they die off, and a
+// trail. Only the particle work is timed, not clearing or presenting.
+static long runParticles(SDL_Renderer *renderer) {
+  ParticleSystem particles;
+  const SDL_Rect camera = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+  const float dt = 1.0f / 60.0f;
+  long drawn = 0;
+  for (int frame = 0; frame < PARTICLE_FRAMES; ++frame) {
+    for (int burst = 0; particles.size() + 200 < MAX_PARTICLES; ++burst) {
+      float x = static_cast<float>((frame * 97 + burst * 211) % SCREEN_WIDTH);
+      float y = static_cast<float>((frame * 53 + burst * 137) % SCREEN_HEIGHT);
+      if (burst % 4 == 0) {
+        particles.confetti(x, y);
+      } else {
+        particles.dust(x, y, 1.0f);
+      }
+    }
+    particles.trail(static_cast<float>(frame * 8 % SCREEN_WIDTH), 270.0f);
+    particles.update(dt);
+    particles.draw(renderer, camera);
+    drawn += static_cast<long>(particles.size());
+  }
+  return drawn;
+}
+
+int main(int argc, char *args[]) {
+  int samples = DEFAULT_SAMPLES;
+  double tolerance = DEFAULT_TOLERANCE;
+  std::string filter, baselinePath, savePath;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(args[i], "--samples") == 0 && i + 1 < argc) {
+      samples = std::atoi(args[++i]);
+    } else if (std::strcmp(args[i], "--filter") == 0 && i + 1 < argc) {
+      filter = args[++i];
+    } else if (std::strcmp(args[i], "--baseline") == 0 && i + 1 < argc) {
+      baselinePath = args[++i];
+    } else if (std::strcmp(args[i], "--save-baseline") == 0 &&
+               i + 1 < argc) {
+      savePath = args[++i];
+    } else if (std::strcmp(args[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = std::atof(args[++i]);
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+  if (samples < 1 || tolerance < 0) {
+    printUsage();
+    return 1;
+  }
+
+  std::map<std::string, double> baseline;
+  if (!baselinePath.empty() && !loadBaseline(baselinePath, baseline)) {
+    return 1;
+  }
+
+  Level level = defaultLevel();
+  SpatialGrid grid;
+  grid.build(level.objects.data(), level.objects.size());
+
+  // A hundred screens, for checking that a frame costs what it does on one
+  Level scrolling;
+  SpatialGrid scrollingGrid;
+  if (!levelFromSeed(1, scrolling, SCROLLING_COURSE)) {
+    std::cerr << "No playable layout for the scrolling course" << std::endl;
+    return 1;
+  }
+  scrollingGrid.build(scrolling.objects.data(), scrolling.objects.size());
+
+  RenderTarget target;
+  if (!initRendering(target)) {
+    closeRendering(target);
+    return 1;
+  }
+  if (!TextureManager::loadTextures(target.renderer) ||
+      !TextureManager::loadFonts()) {
+    closeRendering(target);
+    return 1;
+  }
+  TextRenderer::init(target.renderer);
+  SpriteBatch batch;
+
+  std::vector<Benchmark> benchmarks = {
+      {"physics/trajectories", [&] { return runTrajectories(level, grid); }},
+      {"physics/preview", [&] { return runPreview(level, grid); }},
+      {"generate/12-objects", [] { return runGeneration(12); }},
+      {"generate/48-objects", [] { return runGeneration(48); }},
+      {"generate/96-objects", [] { return runGeneration(96); }},
+      {"textures/cold-load",
+       [&] { return runTextureLoad(target.renderer); }},
+      {"render/frames",
+       [&] { return runFrames(target.renderer, batch, level, grid, 4, 0); }},
+      {"render/particles", [&] { return runParticles(target.renderer); }},
+      {"render/scrolling-100",
+       [&] {
+         return runFrames(target.renderer, batch, scrolling, scrollingGrid,
+                          48, 27);
+       }},
+  };
+
+  std::printf("%-24s %10s %10s %8s %12s\n", "benchmark", "median ms",
+              "min ms", "iqr %", "us/item");
+  std::map<std::string, double> medians;
+  int regressions = 0;
+  for (const Benchmark &benchmark : benchmarks) {
+    if (benchmark.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    Measurement result;
+    if (!measure(benchmark, samples, result)) {
+      std::cerr << benchmark.name << ": failed to run" << std::endl;
+      closeRendering(target);
+      return 1;
+    }
+    medians[benchmark.name] = result.median;
+    std::printf("%-24s %10.3f %10.3f %8.1f %12.3f", benchmark.name.c_str(),
+                result.median, result.fastest,
+                100.0 * result.spread / result.median,
+                1000.0 * result.median / std::max(result.items, 1L));
+
+    auto previous = baseline.find(benchmark.name);
+    if (previous != baseline.end()) {
+      double change = 100.0 * (result.median / previous->second - 1.0);
+      bool regressed = change > tolerance;
+      regressions += regressed;
+      std::printf("  %+.1f%%%s", change, regressed ? "  REGRESSION" : "");
+    }
+    std::printf("\n");
+  }
+
+  closeRendering(target);
+  if (!savePath.empty() && !saveBaseline(savePath, medians)) {
+    return 1;
+  }
+  if (regressions) {
+    std::cerr << regressions << " benchmark(s) slower than the baseline by "
+              << "more than " << tolerance << "%" << std::endl;
+    return 1;
+  }
+  return 0;
+}
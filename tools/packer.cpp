@@ -0,0 +1,223 @@
+// Offline asset packer: decodes images and sounds once and writes them, with
+// fonts, into a single pack that the game maps at startup.
+//
+//   packer [--rate HZ] [--channels N] OUTPUT [FILE...]
+//
+// Sounds are decoded to the format the game opens the device with. That is
+// 48 kHz unless the device runs at another rate, so pass --rate to match such
+// a device; sounds packed at the wrong rate are decoded again at startup.
+// Without FILE arguments the game's own assets are packed. Run from the
+// repository root.
+#include "../AssetPack.h"
+#include "../Audio.h"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_mixer.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char *const DEFAULT_ASSETS[] = {
+    "res/background3.png",       "res/ball.png",
+    "res/arrow.png",             "res/flash_screen.png",
+    "res/tile100x150_light.png", "res/tile100_light.png",
+    "res/hole.png",              "res/com_background.png",
+    "res/font.ttf",              "res/ball_hit.mp3",
+    "res/hole_0.mp3"};
+
+static bool hasExtension(const std::string &path, const char *extension) {
+  size_t length = std::strlen(extension);
+  return path.size() >= length &&
+         path.compare(path.size() - length, length, extension) == 0;
+}
+
+// Pads out to the next multiple of alignment, at most 16, and returns the
+// new position, or -1 if it couldn't be written
+static long padTo(FILE *out, long alignment) {
+  static const char padding[16] = {};
+  long position = std::ftell(out);
+  long aligned = (position + alignment - 1) & ~(alignment - 1);
+  if (position < 0 ||
+      (aligned > position &&
+       std::fwrite(padding, 1, aligned - position, out) !=
+           static_cast<size_t>(aligned - position))) {
+    return -1;
+  }
+  return aligned;
+}
+
+// Appends bytes at the next 16-byte boundary and records where they went
+static bool writeData(FILE *out, const void *bytes, size_t size,
+                      AssetPackEntry &entry) {
+  long aligned = padTo(out, 16);
+  if (aligned < 0) {
+    return false;
+  }
+  entry.offset = static_cast<Uint64>(aligned);
+  entry.size = size;
+  return std::fwrite(bytes, 1, size, out) == size;
+}
+
+static bool packTexture(FILE *out, const std::string &path,
+                        AssetPackEntry &entry) {
+  SDL_Surface *loaded = IMG_Load(path.c_str());
+  if (!loaded) {
+    std::cerr << path << ": " << IMG_GetError() << std::endl;
+    return false;
+  }
+  SDL_Surface *rgba =
+      SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+  SDL_FreeSurface(loaded);
+  if (!rgba) {
+    std::cerr << path << ": " << SDL_GetError() << std::endl;
+    return false;
+  }
+
+  // Store rows tightly packed regardless of the surface pitch
+  std::vector<Uint8> pixels(static_cast<size_t>(rgba->w) * rgba->h * 4);
+  for (int y = 0; y < rgba->h; ++y) {
+    std::memcpy(&pixels[static_cast<size_t>(y) * rgba->w * 4],
+                static_cast<const Uint8 *>(rgba->pixels) + y * rgba->pitch,
+                rgba->w * 4);
+  }
+  entry.type = ASSET_TEXTURE;
+  entry.width = rgba->w;
+  entry.height = rgba->h;
+  entry.pitch = rgba->w * 4;
+  SDL_FreeSurface(rgba);
+  return writeData(out, pixels.data(), pixels.size(), entry);
+}
+
+static bool packSound(FILE *out, const std::string &path,
+                      AssetPackEntry &entry) {
+  Mix_Chunk *chunk = Mix_LoadWAV(path.c_str());
+  if (!chunk) {
+    std::cerr << path << ": " << Mix_GetError() << std::endl;
+    return false;
+  }
+  int frequency = 0, channels = 0;
+  Uint16 format = 0;
+  Mix_QuerySpec(&frequency, &format, &channels);
+  entry.type = ASSET_SOUND;
+  entry.frequency = frequency;
+  entry.format = format;
+  entry.channels = static_cast<Uint16>(channels);
+  bool written = writeData(out, chunk->abuf, chunk->alen, entry);
+  Mix_FreeChunk(chunk);
+  return written;
+}
+
+static bool packFile(FILE *out, const std::string &path,
+                     AssetPackEntry &entry) {
+  FILE *in = std::fopen(path.c_str(), "rb");
+  if (!in) {
+    std::cerr << path << ": unable to open" << std::endl;
+    return false;
+  }
+  std::vector<Uint8> bytes;
+  Uint8 buffer[65536];
+  size_t count;
+  while ((count = std::fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    bytes.insert(bytes.end(), buffer, buffer + count);
+  }
+  std::fclose(in);
+  entry.type = hasExtension(path, ".ttf") ? ASSET_FONT : ASSET_RAW;
+  return writeData(out, bytes.data(), bytes.size(), entry);
+}
+
+int main(int argc, char *args[]) {
+  int frequency = DEFAULT_AUDIO_FREQUENCY, channels = AUDIO_CHANNELS;
+  std::string output;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(args[i], "--rate") == 0 && i + 1 < argc) {
+      frequency = std::atoi(args[++i]);
+    } else if (std::strcmp(args[i], "--channels") == 0 && i + 1 < argc) {
+      channels = std::atoi(args[++i]);
+    } else if (output.empty()) {
+      output = args[i];
+    } else {
+      inputs.push_back(args[i]);
+    }
+  }
+  if (output.empty()) {
+    std::cerr << "usage: packer [--rate HZ] [--channels N] OUTPUT [FILE...]"
+              << std::endl;
+    return 1;
+  }
+  if (inputs.empty()) {
+    inputs.assign(std::begin(DEFAULT_ASSETS), std::end(DEFAULT_ASSETS));
+  }
+
+  // Sounds are decoded through the mixer, which needs an open device; the
+  // dummy driver works on machines without a sound card
+  SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+  if (SDL_Init(SDL_INIT_AUDIO) < 0 || !IMG_Init(IMG_INIT_PNG) ||
+      Mix_Init(MIX_INIT_MP3) == 0 ||
+      Mix_OpenAudio(frequency, MIX_DEFAULT_FORMAT, channels, 4096) == -1) {
+    std::cerr << "Initialization error: " << SDL_GetError() << std::endl;
+    return 1;
+  }
+
+  FILE *out = std::fopen(output.c_str(), "wb");
+  if (!out) {
+    std::cerr << "Unable to create " << output << std::endl;
+    return 1;
+  }
+
+  AssetPackHeader header = {};
+  std::memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+  header.version = ASSET_PACK_VERSION;
+  bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+
+  std::vector<AssetPackEntry> entries;
+  for (size_t i = 0; ok && i < inputs.size(); ++i) {
+    const std::string &path = inputs[i];
+    AssetPackEntry entry = {};
+    if (path.size() >= sizeof(entry.name)) {
+      std::cerr << path << ": name too long" << std::endl;
+      ok = false;
+      break;
+    }
+    std::memcpy(entry.name, path.c_str(), path.size() + 1);
+
+    if (hasExtension(path, ".png")) {
+      ok = packTexture(out, path, entry);
+    } else if (hasExtension(path, ".mp3") || hasExtension(path, ".wav") ||
+               hasExtension(path, ".ogg")) {
+      ok = packSound(out, path, entry);
+    } else {
+      ok = packFile(out, path, entry);
+    }
+    entries.push_back(entry);
+  }
+
+  if (ok) {
+    // The index is read in place, so it must be aligned for its Uint64s
+    long position = padTo(out, alignof(AssetPackEntry));
+    header.indexOffset = static_cast<Uint64>(position);
+    header.entryCount = static_cast<Uint32>(entries.size());
+    ok = position >= 0 &&
+         std::fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(),
+                     out) == entries.size() &&
+         std::fseek(out, 0, SEEK_SET) == 0 &&
+         std::fwrite(&header, sizeof(header), 1, out) == 1;
+  }
+  ok = std::fclose(out) == 0 && ok;
+
+  Mix_CloseAudio();
+  Mix_Quit();
+  IMG_Quit();
+  SDL_Quit();
+
+  if (!ok) {
+    std::remove(output.c_str());
+    return 1;
+  }
+  std::cout << "Packed " << entries.size() << " assets into " << output
+            << std::endl;
+  return 0;
+}